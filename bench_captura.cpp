@@ -0,0 +1,217 @@
+// Prueba y benchmark de captura sin navegador: levanta un Xvfb local, abre una
+// ventana llamada "Firefox" que pinta niveles/nivelN.png en la posición del
+// canvas y la captura con FindWindowByName + ImageFromWindowRegion.
+// Comprueba que los píxeles capturados coinciden bit a bit con el PNG y mide
+// fotogramas/s y latencias p50/p99.
+//
+// Uso: ./bench_captura [iteraciones por nivel]
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "captura.h"
+
+using namespace std;
+
+Window FindWindowByName(Display* display, Window root, const string& name);
+bool ImageFromWindowRegion(Fotograma& fotograma, Window win, Display* display,
+                           int offset_x, int offset_y, int region_width, int region_height);
+void desconectar_captura_shm();
+
+const int CANVAS_X = 666, CANVAS_Y = 275;
+const int CANVAS_ANCHO = 427, CANVAS_ALTO = 640;
+const int VENTANA_ANCHO = 1200, VENTANA_ALTO = 960;
+
+// Arranca Xvfb y devuelve el nombre del display (":N"); -displayfd elige uno libre
+static pid_t iniciar_xvfb(string& nombre_display) {
+    int tubo[2];
+    if (pipe(tubo) != 0) return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(tubo[0]);
+        int nulo = open("/dev/null", O_WRONLY);
+        if (nulo >= 0) dup2(nulo, STDERR_FILENO);
+        string fd = to_string(tubo[1]);
+        execlp("Xvfb", "Xvfb", "-displayfd", fd.c_str(), "-screen", "0", "1600x1000x24",
+               "-nolisten", "tcp", (char*)nullptr);
+        _exit(127);
+    }
+    close(tubo[1]);
+    if (pid < 0) {
+        close(tubo[0]);
+        return -1;
+    }
+    char buf[32] = {0};
+    ssize_t n = read(tubo[0], buf, sizeof(buf) - 1);
+    close(tubo[0]);
+    if (n <= 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, nullptr, 0);
+        return -1;
+    }
+    nombre_display = ":" + string(buf, strcspn(buf, "\n"));
+    return pid;
+}
+
+static void detener_xvfb(pid_t pid) {
+    kill(pid, SIGTERM);
+    waitpid(pid, nullptr, 0);
+}
+
+// Pinta el nivel (RGB) en la ventana con XPutImage en el formato del visual
+static bool pintar_nivel(Display* display, Window win, GC gc, const unsigned char* rgb, int w, int h) {
+    Visual* visual = DefaultVisual(display, DefaultScreen(display));
+    int depth = DefaultDepth(display, DefaultScreen(display));
+    XImage* img = XCreateImage(display, visual, depth, ZPixmap, 0, nullptr, w, h, 32, 0);
+    if (!img) return false;
+    img->data = (char*)malloc((size_t)img->bytes_per_line * h);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            const unsigned char* p = rgb + 3 * ((size_t)y * w + x);
+            unsigned long pixel = ((unsigned long)p[0] << 16) | ((unsigned long)p[1] << 8) | p[2];
+            XPutPixel(img, x, y, pixel);
+        }
+    }
+    XPutImage(display, win, gc, img, 0, 0, CANVAS_X, CANVAS_Y, w, h);
+    XSync(display, False);
+    XDestroyImage(img);
+    return true;
+}
+
+static double percentil(vector<double> v, double p) {
+    if (v.empty()) return 0;
+    sort(v.begin(), v.end());
+    size_t k = min(v.size() - 1, (size_t)(p * (v.size() - 1) + 0.5));
+    return v[k];
+}
+
+int main(int argc, char** argv) {
+    int iteraciones = argc > 1 ? atoi(argv[1]) : 200;
+    if (iteraciones < 1) iteraciones = 1;
+
+    string nombre_display;
+    pid_t xvfb = iniciar_xvfb(nombre_display);
+    if (xvfb < 0) {
+        cerr << "No se pudo iniciar Xvfb (¿está instalado?)" << endl;
+        return 2;
+    }
+
+    Display* display = nullptr;
+    for (int intento = 0; intento < 50 && !display; ++intento) {
+        display = XOpenDisplay(nombre_display.c_str());
+        if (!display) usleep(100000);
+    }
+    if (!display) {
+        cerr << "No se pudo conectar a " << nombre_display << endl;
+        detener_xvfb(xvfb);
+        return 2;
+    }
+
+    int pantalla = DefaultScreen(display);
+    Window root = RootWindow(display, pantalla);
+    Window win = XCreateSimpleWindow(display, root, 0, 0, VENTANA_ANCHO, VENTANA_ALTO, 0,
+                                     BlackPixel(display, pantalla), BlackPixel(display, pantalla));
+    XStoreName(display, win, "Diamond Rush - Mozilla Firefox");
+    XSelectInput(display, win, StructureNotifyMask);
+    XMapWindow(display, win);
+    for (;;) {
+        XEvent ev;
+        XNextEvent(display, &ev);
+        if (ev.type == MapNotify) break;
+    }
+    GC gc = XCreateGC(display, win, 0, nullptr);
+
+    vector<double> latencias;
+    int niveles = 0, errores = 0;
+    double total_busqueda_us = 0;
+
+    for (int nivel = 2; nivel <= 20; ++nivel) {
+        string fname = "niveles/nivel" + to_string(nivel) + ".png";
+        int w, h, c;
+        unsigned char* rgb = stbi_load(fname.c_str(), &w, &h, &c, 3);
+        if (!rgb) {
+            cerr << "No se pudo cargar " << fname << endl;
+            continue;
+        }
+        if (w != CANVAS_ANCHO || h != CANVAS_ALTO || !pintar_nivel(display, win, gc, rgb, w, h)) {
+            cerr << fname << ": tamaño inesperado " << w << "x" << h << endl;
+            stbi_image_free(rgb);
+            ++errores;
+            continue;
+        }
+
+        auto t0 = chrono::steady_clock::now();
+        Window encontrada = FindWindowByName(display, root, "Firefox");
+        total_busqueda_us += chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+        if (encontrada != win) {
+            cerr << "FindWindowByName no devolvió la ventana de prueba" << endl;
+            stbi_image_free(rgb);
+            ++errores;
+            break;
+        }
+
+        Fotograma fotograma;
+        for (int it = 0; it < iteraciones; ++it) {
+            auto inicio = chrono::steady_clock::now();
+            bool ok = ImageFromWindowRegion(fotograma, win, display, CANVAS_X, CANVAS_Y, CANVAS_ANCHO, CANVAS_ALTO);
+            latencias.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - inicio).count());
+            if (!ok) {
+                ++errores;
+                break;
+            }
+        }
+
+        // Comparación bit a bit con el PNG
+        int distintos = 0;
+        if (fotograma.ancho != w || fotograma.alto != h) {
+            distintos = w * h;
+        } else {
+            for (int y = 0; y < h; ++y)
+                for (int x = 0; x < w; ++x) {
+                    const unsigned char* a = fotograma.datos() + (size_t)y * fotograma.stride + 4 * x;
+                    const unsigned char* b = rgb + 3 * ((size_t)y * w + x);
+                    if (a[0] != b[0] || a[1] != b[1] || a[2] != b[2] || a[3] != 255) ++distintos;
+                }
+        }
+        if (distintos) {
+            cerr << "Nivel " << nivel << ": " << distintos << " píxeles distintos" << endl;
+            ++errores;
+        }
+        stbi_image_free(rgb);
+        ++niveles;
+    }
+
+    desconectar_captura_shm();
+    XFreeGC(display, gc);
+    XDestroyWindow(display, win);
+    XCloseDisplay(display);
+    detener_xvfb(xvfb);
+
+    double suma = 0;
+    for (double l : latencias) suma += l;
+    cout << fixed << setprecision(1);
+    cout << "Niveles capturados: " << niveles << ", capturas: " << latencias.size() << endl;
+    if (!latencias.empty()) {
+        cout << "Captura " << CANVAS_ANCHO << "x" << CANVAS_ALTO << ": "
+             << latencias.size() / (suma / 1e6) << " fotogramas/s, p50 " << percentil(latencias, 0.50)
+             << " us, p99 " << percentil(latencias, 0.99) << " us" << endl;
+    }
+    if (niveles) cout << "FindWindowByName: " << total_busqueda_us / niveles << " us de media" << endl;
+    cout << (errores ? "FALLO" : "OK") << " (" << errores << " errores)" << endl;
+    return errores ? 1 : 0;
+}
@@ -0,0 +1,276 @@
+// Benchmark del clasificador sobre los niveles de referencia: clasifica
+// niveles/nivel2..20.png y los compara con extras/niveles.txt (precisión por
+// nivel y matriz de confusión por tipo de casilla), y mide el rendimiento
+// (fotogramas/s y ns por celda) con un hilo y con varios, sin caché de celdas
+// (cada celda se clasifica entera) y con la caché ya caliente, de uno en uno (classify) y en lote
+// (classify_batch).
+//
+// Uso: ./bench_clasificador [iteraciones] [hilos]
+//   iteraciones  pasadas medidas sobre los 19 niveles (200 por defecto)
+//   hilos        hilos de la prueba multihilo (por defecto, los núcleos)
+//
+//      ./bench_clasificador --indice
+//   Comprueba que el VP-tree de las plantillas da lo mismo que el recorrido
+//   lineal. Con las plantillas del juego no se construye (son menos de 64),
+//   así que se le añaden como plantillas las celdas de los niveles impares y
+//   se consulta con las celdas de todos los niveles.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include "clasificador.h"
+
+using namespace std;
+
+const int FILAS = 15, COLUMNAS = 10;
+const int NIVEL_MIN = 2, NIVEL_MAX = 20;
+const int CALENTAMIENTO = 5; // pasadas sin medir antes de cada prueba
+
+struct Nivel {
+    int numero;
+    Fotograma fotograma;
+    vector<vector<int>> referencia;
+};
+
+static double percentil(vector<double> v, double p) {
+    if (v.empty()) return 0;
+    sort(v.begin(), v.end());
+    size_t k = min(v.size() - 1, (size_t)(p * (v.size() - 1) + 0.5));
+    return v[k];
+}
+
+struct Rendimiento {
+    double fotogramas_s, ns_celda, p50_us, p99_us;
+};
+
+// 'tiempos' de llamadas de 'por_llamada' fotogramas cada una
+static Rendimiento resumir(const vector<double>& tiempos, size_t por_llamada) {
+    double total_us = 0;
+    for (double t : tiempos) total_us += t;
+    double fotogramas = (double)tiempos.size() * por_llamada;
+    double celdas = fotogramas * (FILAS - 2) * COLUMNAS; // las dos primeras filas no se clasifican
+    return {fotogramas / (total_us / 1e6), total_us * 1e3 / celdas, percentil(tiempos, 0.50),
+            percentil(tiempos, 0.99)};
+}
+
+// Clasifica todos los niveles 'iteraciones' veces y mide cada classify()
+static Rendimiento medir(const vector<TileTemplate>& plantillas, const vector<Nivel>& niveles, int hilos,
+                         int iteraciones, bool con_cache) {
+    TileClassifier clasificador(plantillas, FILAS, COLUMNAS, hilos);
+    clasificador.usar_cache(con_cache);
+    vector<double> tiempos;
+    tiempos.reserve((size_t)iteraciones * niveles.size());
+    for (int it = -CALENTAMIENTO; it < iteraciones; ++it) {
+        for (const Nivel& n : niveles) {
+            auto t0 = chrono::steady_clock::now();
+            clasificador.classify(n.fotograma);
+            auto t1 = chrono::steady_clock::now();
+            if (it >= 0) tiempos.push_back(chrono::duration<double, micro>(t1 - t0).count());
+        }
+    }
+    return resumir(tiempos, 1);
+}
+
+// Lo mismo con los 19 niveles en cada classify_batch(); las latencias son
+// por lote. Sin caché hace el mismo trabajo que classify() sin caché: los
+// tiles repetidos entre niveles no se aprovechan.
+static Rendimiento medir_lote(const vector<TileTemplate>& plantillas, const vector<Fotograma>& fotogramas,
+                              int hilos, int iteraciones, bool con_cache) {
+    TileClassifier clasificador(plantillas, FILAS, COLUMNAS, hilos);
+    clasificador.usar_cache(con_cache);
+    vector<double> tiempos;
+    for (int it = -CALENTAMIENTO; it < iteraciones; ++it) {
+        auto t0 = chrono::steady_clock::now();
+        clasificador.classify_batch(fotogramas);
+        auto t1 = chrono::steady_clock::now();
+        if (it >= 0) tiempos.push_back(chrono::duration<double, micro>(t1 - t0).count());
+    }
+    return resumir(tiempos, fotogramas.size());
+}
+
+static VistaImagen vista_celda_nivel(const Fotograma& f, int i, int j) {
+    int bw = (int)round((float)f.ancho / COLUMNAS), bh = (int)round((float)f.alto / FILAS);
+    return {f.datos() + (size_t)(i * bh) * f.stride + (size_t)(j * bw) * f.canales(), bw, bh, f.stride, f.canales()};
+}
+
+// Modo --indice: 0 si el VP-tree coincide con el recorrido lineal en todas
+// las consultas
+static int comprobar_indice(vector<TileTemplate> plantillas, const vector<Nivel>& niveles) {
+    vector<Histograma64> consultas, consultas_central;
+    vector<unsigned char> rgb;
+    for (const Nivel& n : niveles) {
+        for (int i = 2; i < FILAS; ++i) {
+            for (int j = 0; j < COLUMNAS; ++j) {
+                VistaImagen celda = vista_celda_nivel(n.fotograma, i, j);
+                Histograma64 h;
+                calcular_histograma_rgb(celda, h);
+                consultas.push_back(h);
+                histograma_central_norm(celda, h);
+                consultas_central.push_back(h);
+                if (n.numero % 2 == 0) continue;
+                rgb.resize((size_t)celda.ancho * celda.alto * 3);
+                for (int y = 0; y < celda.alto; ++y)
+                    for (int x = 0; x < celda.ancho; ++x)
+                        memcpy(&rgb[((size_t)y * celda.ancho + x) * 3], celda.fila(y) + x * celda.canales, 3);
+                TileTemplate t = {};
+                t.name = "nivel" + to_string(n.numero) + "_" + to_string(i) + "_" + to_string(j);
+                t.tipo = -1;
+                asignar_pixeles(t, rgb.data(), celda.ancho, celda.alto);
+                precalcular_rasgos(t);
+                plantillas.push_back(move(t));
+            }
+        }
+    }
+    cout << "Índice VP: " << plantillas.size() << " plantillas, " << consultas.size() << " consultas por modo"
+         << endl;
+    int diferencias = 0;
+    for (bool central : {false, true}) {
+        auto t0 = chrono::steady_clock::now();
+        int d = contar_diferencias_arbol_vp(plantillas, central ? consultas_central : consultas, central);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+        cout << "  " << (central ? "región central: " : "celda completa: ") << d << " diferencias (" << ms
+             << " ms con árbol y recorrido lineal)" << endl;
+        diferencias += d;
+    }
+    return diferencias == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    bool modo_indice = argc > 1 && string(argv[1]) == "--indice";
+    int iteraciones = argc > 1 && !modo_indice ? atoi(argv[1]) : 200;
+    int hilos = argc > 2 ? atoi(argv[2]) : (int)thread::hardware_concurrency();
+    if (iteraciones < 1) iteraciones = 1;
+    if (hilos < 1) hilos = 1;
+
+    vector<TileTemplate> plantillas = cargar_plantillas();
+    if (plantillas.empty()) {
+        cerr << "No se pudieron cargar las plantillas" << endl;
+        return 2;
+    }
+    vector<vector<vector<int>>> referencias = leer_matrices_archivo("extras/niveles.txt", FILAS, COLUMNAS);
+
+    vector<Nivel> niveles;
+    for (int numero = NIVEL_MIN; numero <= NIVEL_MAX; ++numero) {
+        size_t idx_ref = numero - NIVEL_MIN;
+        string fname = "niveles/nivel" + to_string(numero) + ".png";
+        Nivel n = {numero, {}, {}};
+        if (!cargar_fotograma(fname, n.fotograma)) {
+            cerr << "No se pudo cargar " << fname << endl;
+            continue;
+        }
+        if (idx_ref < referencias.size()) n.referencia = referencias[idx_ref];
+        niveles.push_back(move(n));
+    }
+    if (niveles.empty()) return 2;
+    if (modo_indice) return comprobar_indice(plantillas, niveles);
+
+    // --- Precisión ---
+    int max_tipo = 0;
+    for (const Nivel& n : niveles)
+        for (const auto& fila : n.referencia)
+            for (int v : fila) max_tipo = max(max_tipo, v);
+    // Todos los niveles en una llamada; cada uno debe coincidir con classify()
+    vector<Fotograma> fotogramas;
+    for (const Nivel& n : niveles) fotogramas.push_back(n.fotograma);
+    TileClassifier clasificador(plantillas, FILAS, COLUMNAS, hilos);
+    vector<vector<vector<int>>> lote = clasificador.classify_batch(fotogramas);
+    TileClassifier individual(plantillas, FILAS, COLUMNAS, 1);
+    vector<vector<int>> generadas;
+    for (size_t k = 0; k < niveles.size(); ++k) {
+        if (individual.classify(niveles[k].fotograma) != lote[k]) {
+            cerr << "classify_batch no coincide con classify en el nivel " << niveles[k].numero << endl;
+            return 1;
+        }
+        for (const auto& fila : lote[k])
+            for (int v : fila) max_tipo = max(max_tipo, v);
+        generadas.insert(generadas.end(), lote[k].begin(), lote[k].end());
+    }
+    int tipos = max_tipo + 1;
+    vector<vector<int>> confusion(tipos, vector<int>(tipos, 0)); // [referencia][generada]
+
+    cout << fixed << setprecision(1);
+    cout << "Precisión por nivel (" << FILAS << "x" << COLUMNAS << " celdas):" << endl;
+    int aciertos_total = 0, celdas_total = 0;
+    for (size_t k = 0; k < niveles.size(); ++k) {
+        const Nivel& n = niveles[k];
+        cout << "  Nivel " << setw(2) << n.numero << ": ";
+        if (n.referencia.size() != (size_t)FILAS) {
+            cout << "sin matriz de referencia" << endl;
+            continue;
+        }
+        int aciertos = 0;
+        string diferencias;
+        for (int i = 0; i < FILAS; ++i)
+            for (int j = 0; j < COLUMNAS; ++j) {
+                int gen = generadas[k * FILAS + i][j], ref = n.referencia[i][j];
+                if (ref >= 0 && gen >= 0) confusion[ref][gen]++;
+                if (gen == ref) {
+                    ++aciertos;
+                } else {
+                    diferencias += " (" + to_string(i) + "," + to_string(j) + ")=" + to_string(gen) + "/" +
+                                   to_string(ref);
+                }
+            }
+        aciertos_total += aciertos;
+        celdas_total += FILAS * COLUMNAS;
+        cout << setw(3) << aciertos << "/" << FILAS * COLUMNAS << " (" << setw(5) << 100.0 * aciertos / (FILAS * COLUMNAS)
+             << " %)";
+        if (!diferencias.empty()) cout << "  generada/referencia:" << diferencias;
+        cout << endl;
+    }
+    double precision = celdas_total ? 100.0 * aciertos_total / celdas_total : 0;
+    cout << "  Total: " << aciertos_total << "/" << celdas_total << " (" << setprecision(2) << precision
+         << " %)" << setprecision(1) << endl;
+
+    // Solo los tipos que aparecen en la referencia o en la clasificación
+    vector<int> presentes;
+    for (int t = 0; t < tipos; ++t) {
+        bool presente = false;
+        for (int u = 0; u < tipos; ++u) presente = presente || confusion[t][u] || confusion[u][t];
+        if (presente) presentes.push_back(t);
+    }
+    cout << endl << "Matriz de confusión por tipo (filas: referencia, columnas: generada):" << endl << "     ";
+    for (int t : presentes) cout << setw(5) << t;
+    cout << endl;
+    for (int r : presentes) {
+        cout << setw(5) << r;
+        for (int g : presentes) {
+            if (confusion[r][g]) cout << setw(5) << confusion[r][g];
+            else cout << setw(5) << ".";
+        }
+        cout << endl;
+    }
+
+    // --- Rendimiento ---
+    cout << endl << "Rendimiento (" << niveles.size() << " niveles x " << iteraciones << " iteraciones, "
+         << CALENTAMIENTO << " de calentamiento):" << endl;
+    vector<int> pruebas_hilos = {1};
+    if (hilos > 1) pruebas_hilos.push_back(hilos);
+    Rendimiento base = {};
+    for (int h : pruebas_hilos) {
+        for (bool con_cache : {false, true}) {
+            for (bool en_lote : {false, true}) {
+                Rendimiento r = en_lote ? medir_lote(plantillas, fotogramas, h, iteraciones, con_cache)
+                                        : medir(plantillas, niveles, h, iteraciones, con_cache);
+                if (h == 1 && !con_cache && !en_lote) base = r;
+                cout << "  " << h << (h == 1 ? " hilo,  " : " hilos, ") << (con_cache ? "con caché, " : "sin caché, ")
+                     << (en_lote ? "en lote:       " : "de uno en uno: ") << setw(8) << r.fotogramas_s
+                     << " fotogramas/s, " << setw(7) << r.ns_celda << " ns/celda, p50 " << r.p50_us << " us, p99 "
+                     << r.p99_us << " us" << endl;
+            }
+        }
+    }
+
+    // Una línea para comparar entre versiones
+    cout << endl << "RESUMEN precision " << setprecision(2) << precision << " % | " << setprecision(1)
+         << base.fotogramas_s << " fotogramas/s (1 hilo, sin caché) | " << base.ns_celda << " ns/celda" << endl;
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "cache_celdas.h"
+
+using namespace std;
+
+static const char MAGIA[6] = {'D', 'R', 'C', 'A', 'C', 'H'};
+static const uint16_t VERSION_CACHE = 1;
+
+struct EntradaCache {
+    uint64_t clave;
+    int32_t etiqueta;
+    int32_t reservado;
+};
+static_assert(sizeof(EntradaCache) == 16, "formato de caché");
+
+// Ranura: los 56 bits bajos de la clave y la etiqueta + 2 en el byte bajo,
+// que nunca es 0. El conjunto sale de los 17 bits altos de la clave, que con
+// los 56 guardados la reconstruyen entera (ver guardar).
+static const int BITS_CONJUNTO = 17;
+static_assert(CacheCeldas::MAX_ENTRADAS == 2u << BITS_CONJUNTO, "2 vías por conjunto");
+static const uint64_t MASCARA_CLAVE = (1ULL << 56) - 1;
+
+static size_t primera_ranura(uint64_t clave) {
+    return (size_t)(clave >> (64 - BITS_CONJUNTO)) * 2;
+}
+
+static uint64_t empaquetar(uint64_t clave, int etiqueta) {
+    return (clave & MASCARA_CLAVE) << 8 | (uint64_t)(etiqueta + 2);
+}
+
+CacheCeldas::CacheCeldas(uint64_t huella_plantillas)
+    : huella(huella_plantillas), ranuras(new atomic<uint64_t>[MAX_ENTRADAS]) {
+    limpiar();
+}
+
+bool CacheCeldas::buscar(uint64_t hash, bool bloqueada, int& etiqueta) const {
+    uint64_t k = clave(hash, bloqueada);
+    size_t r = primera_ranura(k);
+    for (size_t v = 0; v < 2; ++v) {
+        uint64_t valor = ranuras[r + v].load(memory_order_relaxed);
+        if (valor && (valor >> 8) == (k & MASCARA_CLAVE)) {
+            n_aciertos.fetch_add(1, memory_order_relaxed);
+            etiqueta = (int)(valor & 0xff) - 2;
+            return true;
+        }
+    }
+    n_fallos.fetch_add(1, memory_order_relaxed);
+    return false;
+}
+
+void CacheCeldas::insertar(uint64_t hash, bool bloqueada, int etiqueta) {
+    insertar_clave(clave(hash, bloqueada), etiqueta);
+}
+
+void CacheCeldas::insertar_clave(uint64_t k, int etiqueta) {
+    if (etiqueta < -1 || etiqueta > 253) return; // no cabe en el byte de la ranura
+    size_t r = primera_ranura(k);
+    uint64_t nuevo = empaquetar(k, etiqueta);
+    // La misma clave o una ranura libre; si no, se reemplaza la vía que elige
+    // un bit de la clave, para no expulsar siempre la misma
+    for (size_t v = 0; v < 2; ++v) {
+        uint64_t valor = ranuras[r + v].load(memory_order_relaxed);
+        if (valor && (valor >> 8) == (k & MASCARA_CLAVE)) {
+            ranuras[r + v].store(nuevo, memory_order_relaxed);
+            return;
+        }
+        if (!valor && ranuras[r + v].compare_exchange_strong(valor, nuevo, memory_order_relaxed)) {
+            n_entradas.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+    }
+    ranuras[r + (k & 1)].store(nuevo, memory_order_relaxed);
+}
+
+void CacheCeldas::limpiar() {
+    for (size_t r = 0; r < MAX_ENTRADAS; ++r) ranuras[r].store(0, memory_order_relaxed);
+    n_entradas.store(0, memory_order_relaxed);
+}
+
+bool CacheCeldas::cargar(const string& archivo) {
+    ifstream entrada(archivo, ios::binary);
+    if (!entrada) return false;
+    char magia[6];
+    uint16_t version = 0;
+    uint64_t huella_archivo = 0, n = 0;
+    if (!entrada.read(magia, 6) || !entrada.read((char*)&version, 2) ||
+        memcmp(magia, MAGIA, 6) != 0 || version != VERSION_CACHE) {
+        cerr << archivo << " no es una caché de celdas compatible" << endl;
+        return false;
+    }
+    if (!entrada.read((char*)&huella_archivo, 8) || !entrada.read((char*)&n, 8)) {
+        cerr << "Caché de celdas truncada" << endl;
+        return false;
+    }
+    if (n > MAX_ENTRADAS) {
+        cerr << archivo << " tiene " << n << " entradas, más de " << MAX_ENTRADAS << "; se ignora" << endl;
+        return false;
+    }
+    if (huella_archivo != huella) {
+        cerr << archivo << " es de otras plantillas; se ignora" << endl;
+        return false;
+    }
+    vector<EntradaCache> leidas(n);
+    if (!entrada.read((char*)leidas.data(), n * sizeof(EntradaCache))) {
+        cerr << "Caché de celdas truncada" << endl;
+        return false;
+    }
+    for (const EntradaCache& e : leidas) insertar_clave(e.clave, e.etiqueta);
+    return true;
+}
+
+bool CacheCeldas::guardar(const string& archivo) const {
+    vector<EntradaCache> escritas;
+    escritas.reserve(tamano());
+    for (size_t r = 0; r < MAX_ENTRADAS; ++r) {
+        uint64_t valor = ranuras[r].load(memory_order_relaxed);
+        if (!valor) continue;
+        uint64_t k = valor >> 8 | (uint64_t)(r / 2) << (64 - BITS_CONJUNTO);
+        escritas.push_back({k, (int32_t)(valor & 0xff) - 2, 0});
+    }
+    ofstream salida(archivo, ios::binary | ios::trunc);
+    if (!salida) {
+        cerr << "No se pudo escribir la caché " << archivo << endl;
+        return false;
+    }
+    uint64_t n = escritas.size();
+    salida.write(MAGIA, 6);
+    salida.write((const char*)&VERSION_CACHE, 2);
+    salida.write((const char*)&huella, 8);
+    salida.write((const char*)&n, 8);
+    salida.write((const char*)escritas.data(), n * sizeof(EntradaCache));
+    return (bool)salida;
+}
@@ -0,0 +1,58 @@
+#ifndef CACHE_CELDAS_H
+#define CACHE_CELDAS_H
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <string>
+
+// Caché de etiquetas por contenido exacto de la celda. Los tiles del juego son
+// sprites idénticos píxel a píxel, así que en un tablero asentado casi todas
+// las celdas ya se vieron antes y basta con hashearlas (hash_celda).
+//
+// La clave incluye si la celda está bloqueada, porque entonces se compara otra
+// región. Las entradas solo valen para unas plantillas concretas: la caché
+// lleva su huella y al cargar un archivo de otras plantillas lo descarta.
+//
+// Es una tabla fija de MAX_ENTRADAS ranuras reservada al crearla, asociativa
+// de 2 vías: cada clave solo puede ir en las dos ranuras de su conjunto y, si
+// están ocupadas por otras, reemplaza una. Así la memoria no crece en el bucle
+// del bot aunque cada fotograma de una animación traiga hashes nuevos, y lo
+// que se está viendo desplaza poco a poco a lo antiguo. Cada ranura es un
+// único uint64_t atómico (parte de la clave y la etiqueta), así que buscar e
+// insertar no toman cerrojos ni reservan memoria.
+//
+// Archivo: "DRCACH" + versión (uint16) + huella (uint64) + número de entradas
+// (uint64), y después pares clave (uint64) / etiqueta (int32).
+class CacheCeldas {
+public:
+    static constexpr size_t MAX_ENTRADAS = 1 << 18;
+
+    explicit CacheCeldas(uint64_t huella_plantillas = 0);
+
+    bool buscar(uint64_t hash, bool bloqueada, int& etiqueta) const;
+    void insertar(uint64_t hash, bool bloqueada, int etiqueta);
+    void limpiar();
+
+    size_t tamano() const { return n_entradas.load(std::memory_order_relaxed); }
+    uint64_t aciertos() const { return n_aciertos.load(std::memory_order_relaxed); }
+    uint64_t fallos() const { return n_fallos.load(std::memory_order_relaxed); }
+
+    // false si no existe, no es compatible, es de otras plantillas o tiene
+    // más de MAX_ENTRADAS; salvo si no existe, dice por cerr por qué
+    bool cargar(const std::string& archivo);
+    bool guardar(const std::string& archivo) const;
+
+private:
+    static uint64_t clave(uint64_t hash, bool bloqueada) {
+        return bloqueada ? hash ^ 0x9e3779b97f4a7c15ULL : hash;
+    }
+    void insertar_clave(uint64_t k, int etiqueta);
+
+    uint64_t huella;
+    std::unique_ptr<std::atomic<uint64_t>[]> ranuras; // MAX_ENTRADAS; 0 = libre
+    std::atomic<size_t> n_entradas{0};
+    mutable std::atomic<uint64_t> n_aciertos{0}, n_fallos{0};
+};
+
+#endif
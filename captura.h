@@ -0,0 +1,180 @@
+#ifndef CAPTURA_H
+#define CAPTURA_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+enum class FormatoPixel { RGB, RGBA };
+
+// Imagen en memoria que pasa de la captura al clasificador sin tocar disco
+struct Fotograma {
+    std::vector<uint8_t> pixeles;
+    int ancho = 0, alto = 0;
+    int stride = 0; // bytes por fila
+    FormatoPixel formato = FormatoPixel::RGBA;
+
+    // Geometría y momento de la captura (en cero si viene de un archivo)
+    int region_x = 0, region_y = 0;        // esquina del canvas en la ventana
+    int ventana_ancho = 0, ventana_alto = 0;
+    uint64_t marca_ns = 0;                 // reloj del sistema, en nanosegundos
+
+    // El clasificador redondea el tamaño de celda (15 * 43 = 645 > 640 filas),
+    // así que se dejan filas de margen en cero al final del buffer.
+    static const int MARGEN_FILAS = 16;
+
+    int canales() const { return formato == FormatoPixel::RGBA ? 4 : 3; }
+    const uint8_t* datos() const { return pixeles.data(); }
+    uint8_t* datos() { return pixeles.data(); }
+
+    void reservar(int w, int h, FormatoPixel f) {
+        ancho = w;
+        alto = h;
+        formato = f;
+        stride = w * canales();
+        size_t total = (size_t)stride * (h + MARGEN_FILAS);
+        if (pixeles.size() != total) pixeles.assign(total, 0);
+    }
+};
+
+// Conexión X11 de larga duración: mantiene abierto el display, guarda la
+// ventana del juego y solo la vuelve a buscar cuando se destruye o cambia de
+// tamaño (eventos StructureNotify).
+class SesionCaptura {
+public:
+    explicit SesionCaptura(const std::string& nombre_ventana = "Firefox");
+    ~SesionCaptura();
+    SesionCaptura(const SesionCaptura&) = delete;
+    SesionCaptura& operator=(const SesionCaptura&) = delete;
+
+    // Región del canvas, relativa a la esquina de la ventana
+    void fijar_region(int x, int y, int ancho, int alto);
+    // Activa la búsqueda automática del canvas a partir de la franja de pared
+    // superior ('borde'); el resultado se guarda hasta que la ventana cambia
+    // de tamaño o se vuelve a buscar.
+    void usar_localizador(const Fotograma& borde);
+    bool capturar(Fotograma& fotograma);
+
+    // Modo incremental: con XDamage solo se piden los rectángulos dañados del
+    // canvas y se parchean sobre 'fotograma', que debe ser el mismo objeto entre
+    // llamadas. 'celdas_cambiadas' (filas x columnas, por filas) marca las celdas
+    // tocadas desde la captura anterior. Sin XDamage captura todo y marca todas.
+    bool capturar_incremental(Fotograma& fotograma, std::vector<bool>& celdas_cambiadas,
+                              int filas = 15, int columnas = 10);
+
+private:
+    struct EstadoX; // tipos de Xlib, definidos en tomar_captura.cpp
+
+    bool conectar();
+    bool preparar();
+    bool resolver_ventana();
+    void procesar_eventos();
+    void invalidar_ventana();
+    bool capturar_completo(Fotograma& fotograma);
+    void localizar_region();
+    bool aplicar_danos(Fotograma& fotograma, std::vector<bool>& celdas_cambiadas,
+                       int filas, int columnas);
+
+    std::string nombre_ventana;
+    int region_x = 666, region_y = 275;
+    int region_ancho = 427, region_alto = 640;
+    Fotograma borde;
+    bool region_localizada = false;
+    bool aviso_localizador = false;
+    // Tras una búsqueda fallida no se vuelve a buscar hasta este instante
+    std::chrono::steady_clock::time_point siguiente_busqueda{};
+    std::unique_ptr<EstadoX> x;
+};
+
+// Captura continua en un hilo dedicado. El hilo escribe a la tasa pedida sobre
+// un anillo de buffers ya reservados y publica el último completo; los
+// consumidores lo toman sin bloquear y sin copiarlo. Mientras una Lectura esté
+// viva su buffer no se reescribe. La sesión X vive en el hilo de captura, así
+// que no conviene usar tomar_captura() al mismo tiempo.
+class CapturaContinua {
+    struct Ranura {
+        Fotograma fotograma;
+        uint64_t secuencia = 0;
+        std::atomic<int> estado{0}; // -1 escribiendo, 0 libre, n > 0 lectores
+    };
+
+public:
+    class Lectura {
+    public:
+        Lectura() = default;
+        Lectura(Lectura&& otra) noexcept : ranura(otra.ranura) { otra.ranura = nullptr; }
+        Lectura& operator=(Lectura&& otra) noexcept {
+            if (this != &otra) {
+                soltar();
+                ranura = otra.ranura;
+                otra.ranura = nullptr;
+            }
+            return *this;
+        }
+        ~Lectura() { soltar(); }
+
+        explicit operator bool() const { return ranura != nullptr; }
+        const Fotograma& fotograma() const { return ranura->fotograma; }
+        uint64_t secuencia() const { return ranura->secuencia; }
+
+    private:
+        friend class CapturaContinua;
+        explicit Lectura(Ranura* r) : ranura(r) {}
+        void soltar() {
+            if (ranura) ranura->estado.fetch_sub(1, std::memory_order_release);
+            ranura = nullptr;
+        }
+        Ranura* ranura = nullptr;
+    };
+
+    explicit CapturaContinua(int fps = 30, int buffers = 4, const std::string& nombre_ventana = "Firefox");
+    ~CapturaContinua();
+    CapturaContinua(const CapturaContinua&) = delete;
+    CapturaContinua& operator=(const CapturaContinua&) = delete;
+
+    void usar_localizador(const Fotograma& referencia) { borde = referencia; }
+    void iniciar();
+    void detener();
+
+    // Último fotograma publicado (vacía si todavía no hay ninguno)
+    Lectura ultimo();
+    uint64_t capturados() const { return contador.load(std::memory_order_relaxed); }
+
+private:
+    void bucle();
+
+    std::vector<std::unique_ptr<Ranura>> anillo;
+    std::atomic<int> publicado{-1};
+    std::atomic<uint64_t> contador{0};
+    std::atomic<bool> activo{false};
+    std::thread hilo;
+    int fps;
+    std::string nombre_ventana;
+    Fotograma borde;
+};
+
+// Busca en la imagen completa de la ventana la franja 'borde' (las dos filas
+// de pared con las que empieza el tablero) y devuelve la esquina del canvas.
+bool localizar_canvas(const Fotograma& ventana, const Fotograma& borde, int& canvas_x, int& canvas_y);
+
+// Captura el canvas del juego en 'fotograma' (RGBA). Con guardar_png = true
+// además se vuelca a captura_firefox.png para depurar.
+int tomar_captura(Fotograma& fotograma, bool guardar_png = false);
+void guardar_captura_png(const Fotograma& fotograma);
+
+// Franja de referencia para el localizador: las 86 filas de píxeles de arriba
+// de 'archivo' (las dos filas de tiles de pared, de 43 px, con las que empieza
+// cualquier nivel) a todo su ancho, en RGB. Con niveles/nivel2.png son 427 x 86.
+bool cargar_borde_referencia(const char* archivo, Fotograma& borde);
+
+// La franja del juego: la compilada en el binario con EMBEBER=1 o, si no, la
+// de niveles/nivel2.png (relativa al directorio actual). Si no hay ninguna lo
+// dice por cerr y devuelve false: se usa la región fija del canvas.
+bool cargar_borde_juego(Fotograma& borde);
+
+#endif
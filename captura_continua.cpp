@@ -0,0 +1,93 @@
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include "captura.h"
+
+using namespace std;
+
+CapturaContinua::CapturaContinua(int fps, int buffers, const string& nombre_ventana)
+    : fps(fps > 0 ? fps : 1), nombre_ventana(nombre_ventana) {
+    // Con menos de 3 buffers el hilo se quedaría sin ranura libre mientras se lee
+    if (buffers < 3) buffers = 3;
+    for (int i = 0; i < buffers; ++i) {
+        anillo.emplace_back(new Ranura);
+        anillo.back()->fotograma.reservar(427, 640, FormatoPixel::RGBA);
+    }
+}
+
+CapturaContinua::~CapturaContinua() {
+    detener();
+}
+
+void CapturaContinua::iniciar() {
+    if (activo.exchange(true)) return;
+    hilo = thread(&CapturaContinua::bucle, this);
+}
+
+void CapturaContinua::detener() {
+    activo.store(false);
+    if (hilo.joinable()) hilo.join();
+}
+
+CapturaContinua::Lectura CapturaContinua::ultimo() {
+    for (;;) {
+        int idx = publicado.load(memory_order_acquire);
+        if (idx < 0) return Lectura();
+        Ranura* r = anillo[idx].get();
+        int e = r->estado.load(memory_order_acquire);
+        while (e >= 0) {
+            if (!r->estado.compare_exchange_weak(e, e + 1, memory_order_acquire)) continue;
+            // Entre leer 'publicado' y tomarla, el hilo pudo publicar otra y
+            // reutilizar esta para una captura fallida (que la deja libre y
+            // con secuencia 0): solo vale si sigue siendo la publicada
+            if (publicado.load(memory_order_acquire) == idx && r->secuencia != 0) return Lectura(r);
+            r->estado.fetch_sub(1, memory_order_release);
+            break;
+        }
+        // La ranura ya se está reescribiendo o se reutilizó: hay uno más nuevo publicado
+    }
+}
+
+void CapturaContinua::bucle() {
+    SesionCaptura sesion(nombre_ventana);
+    if (borde.ancho > 0) sesion.usar_localizador(borde);
+
+    const auto periodo = chrono::microseconds(1000000 / fps);
+    int n = (int)anillo.size();
+    int siguiente = 0;
+    while (activo.load(memory_order_relaxed)) {
+        auto inicio = chrono::steady_clock::now();
+
+        // Primera ranura libre que no sea la publicada
+        int actual = publicado.load(memory_order_relaxed);
+        int elegido = -1;
+        bool ok = false;
+        for (int k = 0; k < n && elegido < 0; ++k) {
+            int idx = (siguiente + k) % n;
+            int libre = 0;
+            if (idx != actual && anillo[idx]->estado.compare_exchange_strong(libre, -1, memory_order_acquire))
+                elegido = idx;
+        }
+
+        if (elegido >= 0) {
+            Ranura* r = anillo[elegido].get();
+            r->secuencia = 0; // inválida hasta que la captura termine bien
+            ok = sesion.capturar(r->fotograma);
+            if (ok) r->secuencia = contador.load(memory_order_relaxed) + 1;
+            r->estado.store(0, memory_order_release);
+            if (ok) {
+                publicado.store(elegido, memory_order_release);
+                contador.fetch_add(1, memory_order_relaxed);
+            }
+            siguiente = (elegido + 1) % n;
+        }
+        // Si todas las ranuras están en uso por lectores se salta este ciclo
+
+        // Sin ventana o sin display se reintenta con calma
+        if (elegido >= 0 && !ok)
+            this_thread::sleep_until(inicio + max<chrono::microseconds>(periodo, chrono::seconds(1)));
+        else
+            this_thread::sleep_until(inicio + periodo);
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef CLASIFICADOR_H
+#define CLASIFICADOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "captura.h"
+#include "cache_celdas.h"
+#include "plantillas.h"
+#include "pool_hilos.h"
+
+// Clasificación de celdas del tablero (procesamiento_imagen.cpp)
+
+struct IndicePlantillas;
+
+// Buffers de trabajo de un hilo, reutilizados entre celdas y fotogramas
+struct MemoriaCelda {
+    std::vector<uint8_t> bins;                   // bins de una fila (extraer_rasgos)
+    std::vector<uint16_t> mascaras;              // clases de color de la celda (extraer_rasgos)
+    std::vector<std::pair<double, int>> orden;   // plantillas por cota (buscar_por_cota_gruesa)
+};
+
+// Carga un PNG como fotograma RGB, con el mismo margen que las capturas
+bool cargar_fotograma(const std::string& filename, Fotograma& fotograma);
+
+// Las 'cantidad' primeras plantillas del archivo; todas si es negativa
+std::vector<TileTemplate> cargar_plantillas_preprocesadas(const std::string& archivo, int cantidad = -1);
+
+// Plantillas del bot: las embebidas si se compiló con EMBEBER=1; si no, las
+// de plantillas.pack y, si falta, las de plantillas_preprocesadas.txt. Vacío
+// si no son tile0..tileN-1 seguidas (ver plantillas_contiguas).
+std::vector<TileTemplate> cargar_plantillas();
+
+// Clasificación de celdas. Con 'cache' las celdas ya vistas se resuelven por
+// hash sin calcular rasgos ni comparar plantillas.
+std::vector<std::vector<int>> clasificar_celdas(const Fotograma& fotograma,
+                                                int filas, int columnas, int block_w, int block_h,
+                                                const std::vector<TileTemplate>& templates,
+                                                CacheCeldas* cache = nullptr,
+                                                const IndicePlantillas* indice = nullptr);
+
+// Consultas en las que el VP-tree de las plantillas (que el clasificador solo
+// construye con 64 o más) no da la misma plantilla que el recorrido lineal.
+// 'central' elige los histogramas de bloque bloqueado; las consultas de ese
+// modo van normalizadas. Debe ser 0: el árbol es exacto.
+int contar_diferencias_arbol_vp(const std::vector<TileTemplate>& templates,
+                                const std::vector<Histograma64>& consultas, bool central);
+
+// Motor de clasificación de larga duración para el bucle del bot: es dueño de
+// las plantillas y sus rasgos, del índice, de la caché de celdas, de los
+// buffers de cada hilo y de la rejilla de salida, así que clasificar un
+// fotograma no crea hilos ni reserva memoria (la caché de celdas es una tabla
+// fija, reservada al crearla).
+class TileClassifier {
+public:
+    // hilos = 0 usa tantos como núcleos
+    explicit TileClassifier(std::vector<TileTemplate> plantillas, int filas = 15, int columnas = 10, int hilos = 0);
+    ~TileClassifier();
+
+    // Clasifica todas las celdas. La rejilla devuelta se reutiliza en la
+    // siguiente llamada.
+    const std::vector<std::vector<int>>& classify(const Fotograma& fotograma);
+
+    // Como classify, pero solo reclasifica las celdas cuyo hash cambió desde la
+    // llamada anterior. Que una celda esté bloqueada solo depende de su fila,
+    // así que no hay vecinas que revisar. 'celdas_tocadas' (opcional, por
+    // filas) viene de capturar_incremental: las no tocadas ni se hashean.
+    const std::vector<std::vector<int>>& classify_incremental(const Fotograma& fotograma,
+                                                              const std::vector<bool>* celdas_tocadas = nullptr);
+
+    // Clasifica varios tableros en una llamada, repartiendo los pares
+    // (fotograma, celda) entre los hilos del pool con la misma caché de
+    // celdas. Los fotogramas pueden tener tamaños distintos. No cambia el
+    // estado de classify_incremental.
+    std::vector<std::vector<std::vector<int>>> classify_batch(const std::vector<Fotograma>& fotogramas);
+
+    // Celdas que se clasificaron (o consultaron en caché) en la última llamada
+    int reclasificadas() const { return n_reclasificadas.load(std::memory_order_relaxed); }
+
+    const std::vector<TileTemplate>& plantillas() const { return templates; }
+    CacheCeldas& cache() { return cache_celdas; }
+    // Sin caché cada celda se clasifica entera, aunque se repita (para medir)
+    void usar_cache(bool usar) { con_cache = usar; }
+    int hilos() const { return pool.tamano(); }
+
+private:
+    // Ajusta la geometría al fotograma; true si cambió (hay que reclasificar todo)
+    bool preparar(const Fotograma& fotograma);
+    void procesar(const Fotograma& fotograma, const std::vector<bool>* celdas_tocadas, bool todas);
+
+    std::vector<TileTemplate> templates;
+    std::unique_ptr<IndicePlantillas> indice;
+    CacheCeldas cache_celdas;
+    bool con_cache = true;
+    int filas, columnas;
+    PoolHilos pool;
+    std::vector<MemoriaCelda> memoria; // una por hilo del pool
+
+    int ancho = 0, alto = 0, block_w = 0, block_h = 0;
+    std::vector<std::vector<int>> etiquetas;
+    std::vector<uint64_t> hashes;
+    std::atomic<int> n_reclasificadas{0};
+};
+
+// Matrices de referencia ("Nivel N:" seguido de 'filas' filas), en orden
+std::vector<std::vector<std::vector<int>>> leer_matrices_archivo(const std::string& filename, int filas, int columnas);
+bool matrices_iguales(const std::vector<std::vector<int>>& a, const std::vector<std::vector<int>>& b);
+void imprimir_matriz(const std::vector<std::vector<int>>& etiquetas);
+void guardar_matriz_txt(const std::vector<std::vector<int>>& etiquetas, const std::string& filename);
+
+#endif
@@ -0,0 +1,103 @@
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <iostream>
+
+#include "estabilidad.h"
+#include "grabacion.h"
+#include "hash64.h"
+
+using namespace std;
+
+uint64_t hash_celda(const Fotograma& fotograma, int block_w, int block_h, int i, int j) {
+    // Recorre exactamente los bytes de vista_celda
+    Hash64 h;
+    int canales = fotograma.canales();
+    unsigned char fila_rgb[256 * 3];
+    for (int y = 0; y < block_h; ++y) {
+        const unsigned char* src = fotograma.datos() + (size_t)(i * block_h + y) * fotograma.stride +
+                                   (size_t)(j * block_w) * canales;
+        if (canales == 3) {
+            h.actualizar(src, (size_t)block_w * 3);
+            continue;
+        }
+        for (int x0 = 0; x0 < block_w; x0 += 256) {
+            int n = min(256, block_w - x0);
+            for (int x = 0; x < n; ++x) {
+                fila_rgb[3 * x + 0] = src[(x0 + x) * canales + 0];
+                fila_rgb[3 * x + 1] = src[(x0 + x) * canales + 1];
+                fila_rgb[3 * x + 2] = src[(x0 + x) * canales + 2];
+            }
+            h.actualizar(fila_rgb, (size_t)n * 3);
+        }
+    }
+    return h.final();
+}
+
+void calcular_firma(const Fotograma& fotograma, int filas, int columnas, FirmaTablero& firma) {
+    int block_h = (int)round((float)fotograma.alto / filas);
+    int block_w = (int)round((float)fotograma.ancho / columnas);
+    firma.filas = filas;
+    firma.columnas = columnas;
+    firma.hashes.resize((size_t)filas * columnas);
+    for (int i = 0; i < filas; ++i)
+        for (int j = 0; j < columnas; ++j)
+            firma.hashes[i * columnas + j] = hash_celda(fotograma, block_w, block_h, i, j);
+}
+
+DetectorEstabilidad::DetectorEstabilidad(int fotogramas_iguales, int filas, int columnas)
+    : requeridos(fotogramas_iguales > 1 ? fotogramas_iguales : 1), filas(filas), columnas(columnas) {}
+
+void DetectorEstabilidad::reiniciar() {
+    iguales = 0;
+    actual = FirmaTablero();
+    anterior = FirmaTablero();
+    celdas_cambiadas.clear();
+}
+
+bool DetectorEstabilidad::actualizar(const Fotograma& fotograma) {
+    swap(actual, anterior);
+    calcular_firma(fotograma, filas, columnas, actual);
+
+    bool primero = anterior.hashes.size() != actual.hashes.size();
+    celdas_cambiadas.assign(actual.hashes.size(), primero);
+    bool igual = !primero;
+    if (!primero) {
+        for (size_t k = 0; k < actual.hashes.size(); ++k) {
+            if (actual.hashes[k] != anterior.hashes[k]) {
+                celdas_cambiadas[k] = true;
+                igual = false;
+            }
+        }
+    }
+    // El primer fotograma ya cuenta como uno de la racha
+    iguales = igual ? iguales + 1 : 1;
+    return estable();
+}
+
+bool capturar_estable(Fotograma& fotograma, int fotogramas_iguales, int espera_max_ms,
+                      GrabadorFotogramas* grabador) {
+    CapturaContinua captura(60);
+    Fotograma borde;
+    if (cargar_borde_juego(borde)) captura.usar_localizador(borde);
+    captura.iniciar();
+
+    DetectorEstabilidad detector(fotogramas_iguales);
+    auto limite = chrono::steady_clock::now() + chrono::milliseconds(espera_max_ms);
+    uint64_t ultima_secuencia = 0;
+    bool hay_fotograma = false;
+    while (chrono::steady_clock::now() < limite) {
+        CapturaContinua::Lectura lectura = captura.ultimo();
+        if (!lectura || lectura.secuencia() == ultima_secuencia) {
+            this_thread::sleep_for(chrono::milliseconds(2));
+            continue;
+        }
+        ultima_secuencia = lectura.secuencia();
+        fotograma = lectura.fotograma();
+        hay_fotograma = true;
+        if (grabador && grabador->abierto()) grabador->escribir(fotograma);
+        if (detector.actualizar(fotograma)) return true;
+    }
+    if (hay_fotograma) cerr << "El tablero no se estabilizó; se usa la última captura\n";
+    return hay_fotograma;
+}
@@ -0,0 +1,58 @@
+#ifndef ESTABILIDAD_H
+#define ESTABILIDAD_H
+
+#include <cstdint>
+#include <vector>
+
+#include "captura.h"
+
+// Firma barata de un fotograma: un hash de 64 bits por celda de la rejilla,
+// con la misma geometría de celdas que clasificar_celdas.
+struct FirmaTablero {
+    int filas = 0, columnas = 0;
+    std::vector<uint64_t> hashes; // por filas
+
+    bool operator==(const FirmaTablero& otra) const {
+        return filas == otra.filas && columnas == otra.columnas && hashes == otra.hashes;
+    }
+    bool operator!=(const FirmaTablero& otra) const { return !(*this == otra); }
+};
+
+// Hash del contenido RGB de la celda (i, j); no depende de si el fotograma es RGB o RGBA
+uint64_t hash_celda(const Fotograma& fotograma, int block_w, int block_h, int i, int j);
+void calcular_firma(const Fotograma& fotograma, int filas, int columnas, FirmaTablero& firma);
+
+// Detecta cuándo el tablero se asentó: N fotogramas seguidos con la misma
+// firma. Así el clasificador solo corre sobre tableros estables en lugar de
+// dormir un tiempo fijo o clasificar en mitad de una animación.
+class DetectorEstabilidad {
+public:
+    explicit DetectorEstabilidad(int fotogramas_iguales = 3, int filas = 15, int columnas = 10);
+
+    // Añade un fotograma y devuelve true si el tablero está estable
+    bool actualizar(const Fotograma& fotograma);
+    bool estable() const { return iguales >= requeridos; }
+    void reiniciar();
+
+    const FirmaTablero& firma() const { return actual; }
+    // Celdas cuyo hash cambió respecto al fotograma anterior (todas en el primero)
+    const std::vector<bool>& cambios() const { return celdas_cambiadas; }
+
+private:
+    int requeridos;
+    int filas, columnas;
+    int iguales = 0;
+    FirmaTablero actual, anterior;
+    std::vector<bool> celdas_cambiadas;
+};
+
+class GrabadorFotogramas;
+
+// Captura en continuo hasta que el tablero quede estable y lo copia en
+// 'fotograma'. Si pasa 'espera_max_ms' se devuelve el último capturado. Con
+// 'grabador' se graban todos los fotogramas vistos mientras tanto, así que
+// después del primero van como delta.
+bool capturar_estable(Fotograma& fotograma, int fotogramas_iguales = 3, int espera_max_ms = 3000,
+                      GrabadorFotogramas* grabador = nullptr);
+
+#endif
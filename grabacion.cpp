@@ -0,0 +1,219 @@
+#include <cstring>
+#include <iostream>
+
+#include "grabacion.h"
+
+using namespace std;
+
+static const char MAGIA[6] = {'D', 'R', 'G', 'R', 'A', 'B'};
+static const uint16_t VERSION_GRABACION = 1;
+
+// ---- Codificación delta ----
+
+static void escribir_varint(vector<uint8_t>& out, uint32_t v) {
+    while (v >= 0x80) {
+        out.push_back(uint8_t(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(uint8_t(v));
+}
+
+static bool leer_varint(const uint8_t*& p, const uint8_t* fin, uint32_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 35 && p < fin; shift += 7) {
+        uint8_t b = *p++;
+        v |= uint32_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// XOR con el anterior, en tramos de ceros y de literales
+static void codificar_delta(const vector<uint8_t>& actual, const vector<uint8_t>& anterior, vector<uint8_t>& out) {
+    out.clear();
+    size_t n = actual.size(), i = 0;
+    while (i < n) {
+        size_t inicio = i;
+        while (i < n && actual[i] == anterior[i]) ++i;
+        uint32_t ceros = uint32_t(i - inicio);
+        inicio = i;
+        // Un tramo literal termina en cuanto aparecen al menos 4 bytes iguales seguidos
+        size_t iguales = 0;
+        while (i < n && iguales < 4) {
+            iguales = actual[i] == anterior[i] ? iguales + 1 : 0;
+            ++i;
+        }
+        if (iguales == 4) i -= 4;
+        uint32_t literales = uint32_t(i - inicio);
+        escribir_varint(out, ceros);
+        escribir_varint(out, literales);
+        for (size_t k = inicio; k < i; ++k) out.push_back(actual[k] ^ anterior[k]);
+    }
+}
+
+static bool decodificar_delta(const uint8_t* p, size_t bytes, vector<uint8_t>& imagen) {
+    const uint8_t* fin = p + bytes;
+    size_t i = 0, n = imagen.size();
+    while (p < fin) {
+        uint32_t ceros, literales;
+        if (!leer_varint(p, fin, ceros) || !leer_varint(p, fin, literales)) return false;
+        i += ceros;
+        if (i + literales > n || p + literales > fin) return false;
+        for (uint32_t k = 0; k < literales; ++k) imagen[i++] ^= *p++;
+    }
+    return i <= n;
+}
+
+// ---- Grabador ----
+
+bool GrabadorFotogramas::abrir(const string& archivo, bool anexar) {
+    cerrar();
+    bool existe = false;
+    if (anexar) {
+        ifstream prueba(archivo, ios::binary);
+        char magia[6];
+        uint16_t version = 0;
+        if (prueba.read(magia, 6) && prueba.read((char*)&version, 2)) {
+            if (memcmp(magia, MAGIA, 6) != 0 || version != VERSION_GRABACION) {
+                cerr << archivo << " no es una grabación compatible" << endl;
+                return false;
+            }
+            existe = true;
+        }
+    }
+    salida.open(archivo, ios::binary | (existe ? ios::app : ios::trunc));
+    if (!salida) {
+        cerr << "No se pudo abrir " << archivo << " para grabar" << endl;
+        return false;
+    }
+    if (!existe) {
+        salida.write(MAGIA, 6);
+        salida.write((const char*)&VERSION_GRABACION, 2);
+    }
+    // Lo primero que se escriba en esta sesión va crudo
+    ancho = alto = 0;
+    desde_clave = 0;
+    return (bool)salida;
+}
+
+void GrabadorFotogramas::cerrar() {
+    if (salida.is_open()) salida.close();
+}
+
+bool GrabadorFotogramas::escribir(const Fotograma& fotograma) {
+    if (!salida.is_open()) return false;
+
+    // RGB compacto, sin margen ni alfa
+    int w = fotograma.ancho, h = fotograma.alto, canales = fotograma.canales();
+    actual.resize((size_t)w * h * 3);
+    for (int y = 0; y < h; ++y) {
+        const uint8_t* src = fotograma.datos() + (size_t)y * fotograma.stride;
+        uint8_t* dst = actual.data() + (size_t)y * w * 3;
+        if (canales == 3) {
+            memcpy(dst, src, (size_t)w * 3);
+            continue;
+        }
+        for (int x = 0; x < w; ++x, src += canales, dst += 3) {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+
+    CabeceraFotograma cab = {};
+    cab.marca_ns = fotograma.marca_ns;
+    cab.ancho = w;
+    cab.alto = h;
+    cab.region_x = fotograma.region_x;
+    cab.region_y = fotograma.region_y;
+    cab.ventana_ancho = fotograma.ventana_ancho;
+    cab.ventana_alto = fotograma.ventana_alto;
+
+    bool clave = w != ancho || h != alto || desde_clave >= CLAVE_CADA;
+    if (!clave) {
+        codificar_delta(actual, anterior, codificado);
+        clave = codificado.size() >= actual.size();
+    }
+    const vector<uint8_t>& datos = clave ? actual : codificado;
+    cab.codificacion = clave ? FOTOGRAMA_CRUDO : FOTOGRAMA_DELTA;
+    cab.bytes = (uint32_t)datos.size();
+
+    salida.write((const char*)&cab, sizeof(cab));
+    salida.write((const char*)datos.data(), datos.size());
+
+    desde_clave = clave ? 1 : desde_clave + 1;
+    ancho = w;
+    alto = h;
+    swap(anterior, actual);
+    return (bool)salida;
+}
+
+// ---- Reproductor ----
+
+bool ReproductorFotogramas::abrir(const string& archivo) {
+    entrada.close();
+    entrada.clear();
+    entrada.open(archivo, ios::binary);
+    if (!entrada) {
+        cerr << "No se pudo abrir la grabación " << archivo << endl;
+        return false;
+    }
+    char magia[6];
+    uint16_t version = 0;
+    if (!entrada.read(magia, 6) || !entrada.read((char*)&version, 2) ||
+        memcmp(magia, MAGIA, 6) != 0 || version != VERSION_GRABACION) {
+        cerr << archivo << " no es una grabación compatible" << endl;
+        entrada.close();
+        return false;
+    }
+    ancho = alto = 0;
+    return true;
+}
+
+void ReproductorFotogramas::reiniciar() {
+    entrada.clear();
+    entrada.seekg(8);
+    ancho = alto = 0;
+}
+
+bool ReproductorFotogramas::siguiente(Fotograma& fotograma) {
+    CabeceraFotograma cab;
+    if (!entrada.is_open() || !entrada.read((char*)&cab, sizeof(cab))) return false;
+    codificado.resize(cab.bytes);
+    if (!entrada.read((char*)codificado.data(), cab.bytes)) {
+        cerr << "Grabación truncada" << endl;
+        return false;
+    }
+
+    size_t total = (size_t)cab.ancho * cab.alto * 3;
+    if (cab.codificacion == FOTOGRAMA_CRUDO) {
+        if (cab.bytes != total) return false;
+        anterior.swap(codificado);
+    } else {
+        if ((int)cab.ancho != ancho || (int)cab.alto != alto ||
+            !decodificar_delta(codificado.data(), codificado.size(), anterior)) {
+            cerr << "Delta inválido en la grabación" << endl;
+            return false;
+        }
+    }
+    ancho = cab.ancho;
+    alto = cab.alto;
+
+    fotograma.reservar(ancho, alto, FormatoPixel::RGBA);
+    for (int y = 0; y < alto; ++y) {
+        const uint8_t* src = anterior.data() + (size_t)y * ancho * 3;
+        uint8_t* dst = fotograma.datos() + (size_t)y * fotograma.stride;
+        for (int x = 0; x < ancho; ++x, src += 3, dst += 4) {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = 255;
+        }
+    }
+    fotograma.region_x = cab.region_x;
+    fotograma.region_y = cab.region_y;
+    fotograma.ventana_ancho = cab.ventana_ancho;
+    fotograma.ventana_alto = cab.ventana_alto;
+    fotograma.marca_ns = cab.marca_ns;
+    return true;
+}
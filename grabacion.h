@@ -0,0 +1,63 @@
+#ifndef GRABACION_H
+#define GRABACION_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "captura.h"
+
+// Grabación binaria de sesiones de captura para reproducirlas sin Firefox.
+//
+// Archivo: "DRGRAB" + versión (uint16), y después un registro por fotograma:
+// CabeceraFotograma seguida de 'bytes' de datos. Los píxeles se guardan en RGB
+// (el alfa de la captura siempre es 255), crudos o como delta: XOR con el
+// fotograma anterior codificado en tramos (varint ceros, varint literales,
+// literales). Cada CLAVE_CADA fotogramas, al cambiar de tamaño o al empezar a
+// anexar se escribe uno crudo para no depender de todo lo anterior.
+
+enum CodificacionFotograma : uint8_t { FOTOGRAMA_CRUDO = 0, FOTOGRAMA_DELTA = 1 };
+
+struct CabeceraFotograma {
+    uint64_t marca_ns;
+    uint32_t ancho, alto;
+    int32_t region_x, region_y;
+    int32_t ventana_ancho, ventana_alto;
+    uint32_t bytes;
+    uint8_t codificacion;
+    uint8_t reservado[3];
+};
+static_assert(sizeof(CabeceraFotograma) == 40, "formato de grabación");
+
+class GrabadorFotogramas {
+public:
+    // Con anexar = true se añade al final de una grabación existente
+    bool abrir(const std::string& archivo, bool anexar = true);
+    bool escribir(const Fotograma& fotograma);
+    void cerrar();
+    bool abierto() const { return salida.is_open(); }
+
+    static const int CLAVE_CADA = 120;
+
+private:
+    std::ofstream salida;
+    std::vector<uint8_t> anterior, actual, codificado;
+    int ancho = 0, alto = 0;
+    int desde_clave = 0;
+};
+
+class ReproductorFotogramas {
+public:
+    bool abrir(const std::string& archivo);
+    // Siguiente fotograma en RGBA, igual que tomar_captura; false al terminar
+    bool siguiente(Fotograma& fotograma);
+    void reiniciar();
+
+private:
+    std::ifstream entrada;
+    std::vector<uint8_t> anterior, codificado;
+    int ancho = 0, alto = 0;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef HASH64_H
+#define HASH64_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+// XXH64 (xxHash de 64 bits), suficiente para identificar celdas y plantillas
+// por contenido. Se usa en streaming para poder hashear imágenes con stride.
+
+namespace hash64_detalle {
+
+const uint64_t P1 = 11400714785074694791ULL;
+const uint64_t P2 = 14029467366897019727ULL;
+const uint64_t P3 = 1609587929392839161ULL;
+const uint64_t P4 = 9650029242287828579ULL;
+const uint64_t P5 = 2870177450012600261ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t leer64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+inline uint32_t leer32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint64_t ronda(uint64_t acc, uint64_t entrada) {
+    acc += entrada * P2;
+    acc = rotl(acc, 31);
+    return acc * P1;
+}
+
+inline uint64_t mezclar(uint64_t acc, uint64_t v) {
+    acc ^= ronda(0, v);
+    return acc * P1 + P4;
+}
+
+} // namespace hash64_detalle
+
+class Hash64 {
+public:
+    explicit Hash64(uint64_t semilla = 0) {
+        using namespace hash64_detalle;
+        v[0] = semilla + P1 + P2;
+        v[1] = semilla + P2;
+        v[2] = semilla;
+        v[3] = semilla - P1;
+        this->semilla = semilla;
+    }
+
+    void actualizar(const void* datos, size_t n) {
+        using namespace hash64_detalle;
+        const uint8_t* p = (const uint8_t*)datos;
+        total += n;
+        if (pendientes + n < 32) {
+            memcpy(buffer + pendientes, p, n);
+            pendientes += n;
+            return;
+        }
+        if (pendientes) {
+            size_t falta = 32 - pendientes;
+            memcpy(buffer + pendientes, p, falta);
+            procesar_bloque(buffer);
+            p += falta;
+            n -= falta;
+            pendientes = 0;
+        }
+        while (n >= 32) {
+            procesar_bloque(p);
+            p += 32;
+            n -= 32;
+        }
+        memcpy(buffer, p, n);
+        pendientes = n;
+    }
+
+    uint64_t final() const {
+        using namespace hash64_detalle;
+        uint64_t h;
+        if (total >= 32) {
+            h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+            for (int k = 0; k < 4; ++k) h = mezclar(h, v[k]);
+        } else {
+            h = semilla + P5;
+        }
+        h += total;
+
+        const uint8_t* p = buffer;
+        size_t n = pendientes;
+        while (n >= 8) {
+            h ^= ronda(0, leer64(p));
+            h = rotl(h, 27) * P1 + P4;
+            p += 8;
+            n -= 8;
+        }
+        if (n >= 4) {
+            h ^= (uint64_t)leer32(p) * P1;
+            h = rotl(h, 23) * P2 + P3;
+            p += 4;
+            n -= 4;
+        }
+        while (n > 0) {
+            h ^= (*p) * P5;
+            h = rotl(h, 11) * P1;
+            ++p;
+            --n;
+        }
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    void procesar_bloque(const uint8_t* p) {
+        using namespace hash64_detalle;
+        for (int k = 0; k < 4; ++k) v[k] = ronda(v[k], leer64(p + 8 * k));
+    }
+
+    uint64_t v[4];
+    uint64_t semilla;
+    uint64_t total = 0;
+    uint8_t buffer[32];
+    size_t pendientes = 0;
+};
+
+inline uint64_t hash64(const void* datos, size_t n, uint64_t semilla = 0) {
+    Hash64 h(semilla);
+    h.actualizar(datos, n);
+    return h.final();
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#include "captura.h"
+
+using namespace std;
+
+// Localiza el canvas del juego dentro de la imagen completa de la ventana.
+// Las dos primeras filas del tablero siempre son pared (la misma suposición de
+// clasificar_celdas), así que se busca esa franja con SAD en escala de grises
+// sobre una pirámide: búsqueda exhaustiva en el nivel más reducido y refinado
+// local de los mejores candidatos hasta resolución completa.
+
+namespace {
+
+struct ImagenGris {
+    vector<uint8_t> p;
+    int w = 0, h = 0;
+};
+
+const int NIVELES_PIRAMIDE = 4;    // 427 px de ancho -> 26 px en el nivel más reducido
+const int CANDIDATOS = 8;          // posiciones del nivel reducido que se refinan
+const int RADIO_REFINADO = 2;      // vecindad (en píxeles del nivel) al subir de nivel
+
+ImagenGris a_gris(const Fotograma& f, int x0, int y0, int w, int h) {
+    ImagenGris g;
+    g.w = w;
+    g.h = h;
+    g.p.resize((size_t)w * h);
+    int canales = f.canales();
+    for (int y = 0; y < h; ++y) {
+        const uint8_t* src = f.datos() + (size_t)(y0 + y) * f.stride + x0 * canales;
+        uint8_t* dst = g.p.data() + (size_t)y * w;
+        for (int x = 0; x < w; ++x, src += canales)
+            dst[x] = (uint8_t)((src[0] * 77 + src[1] * 150 + src[2] * 29) >> 8);
+    }
+    return g;
+}
+
+// Promedio 2x2
+ImagenGris reducir(const ImagenGris& g) {
+    ImagenGris r;
+    r.w = g.w / 2;
+    r.h = g.h / 2;
+    r.p.resize((size_t)r.w * r.h);
+    for (int y = 0; y < r.h; ++y) {
+        const uint8_t* a = g.p.data() + (size_t)(2 * y) * g.w;
+        const uint8_t* b = a + g.w;
+        for (int x = 0; x < r.w; ++x)
+            r.p[(size_t)y * r.w + x] = (uint8_t)((a[2 * x] + a[2 * x + 1] + b[2 * x] + b[2 * x + 1] + 2) >> 2);
+    }
+    return r;
+}
+
+// SAD de la plantilla colocada en (x, y); corta en cuanto supera 'limite'
+uint64_t sad(const ImagenGris& img, const ImagenGris& t, int x, int y, uint64_t limite) {
+    uint64_t total = 0;
+    for (int ty = 0; ty < t.h; ++ty) {
+        const uint8_t* a = img.p.data() + (size_t)(y + ty) * img.w + x;
+        const uint8_t* b = t.p.data() + (size_t)ty * t.w;
+        for (int tx = 0; tx < t.w; ++tx)
+            total += (uint64_t)abs(int(a[tx]) - int(b[tx]));
+        if (total > limite) break;
+    }
+    return total;
+}
+
+struct Candidato {
+    int x, y;
+    uint64_t error;
+};
+
+} // namespace
+
+bool localizar_canvas(const Fotograma& ventana, const Fotograma& borde, int& canvas_x, int& canvas_y) {
+    if (borde.ancho > ventana.ancho || borde.alto > ventana.alto || borde.ancho == 0) return false;
+
+    vector<ImagenGris> img(NIVELES_PIRAMIDE + 1), tpl(NIVELES_PIRAMIDE + 1);
+    img[0] = a_gris(ventana, 0, 0, ventana.ancho, ventana.alto);
+    tpl[0] = a_gris(borde, 0, 0, borde.ancho, borde.alto);
+    for (int l = 1; l <= NIVELES_PIRAMIDE; ++l) {
+        img[l] = reducir(img[l - 1]);
+        tpl[l] = reducir(tpl[l - 1]);
+    }
+
+    // Nivel más reducido: búsqueda exhaustiva conservando los mejores candidatos
+    const ImagenGris& ic = img[NIVELES_PIRAMIDE];
+    const ImagenGris& tc = tpl[NIVELES_PIRAMIDE];
+    vector<Candidato> mejores;
+    for (int y = 0; y + tc.h <= ic.h; ++y) {
+        for (int x = 0; x + tc.w <= ic.w; ++x) {
+            uint64_t limite = mejores.size() < CANDIDATOS ? numeric_limits<uint64_t>::max()
+                                                          : mejores.back().error;
+            uint64_t e = sad(ic, tc, x, y, limite);
+            if (e >= limite) continue;
+            Candidato c = {x, y, e};
+            mejores.insert(upper_bound(mejores.begin(), mejores.end(), c,
+                                       [](const Candidato& a, const Candidato& b) { return a.error < b.error; }),
+                           c);
+            if ((int)mejores.size() > CANDIDATOS) mejores.pop_back();
+        }
+    }
+
+    // Refinado: cada candidato baja de nivel buscando en una vecindad pequeña
+    Candidato mejor = {0, 0, numeric_limits<uint64_t>::max()};
+    for (Candidato c : mejores) {
+        for (int l = NIVELES_PIRAMIDE - 1; l >= 0; --l) {
+            const ImagenGris& im = img[l];
+            const ImagenGris& t = tpl[l];
+            Candidato local = {0, 0, numeric_limits<uint64_t>::max()};
+            for (int dy = -RADIO_REFINADO; dy <= RADIO_REFINADO; ++dy) {
+                for (int dx = -RADIO_REFINADO; dx <= RADIO_REFINADO; ++dx) {
+                    int x = 2 * c.x + dx, y = 2 * c.y + dy;
+                    if (x < 0 || y < 0 || x + t.w > im.w || y + t.h > im.h) continue;
+                    uint64_t e = sad(im, t, x, y, local.error);
+                    if (e < local.error) local = {x, y, e};
+                }
+            }
+            c = local;
+            if (c.error == numeric_limits<uint64_t>::max()) break;
+        }
+        if (c.error < mejor.error) mejor = c;
+    }
+    if (mejor.error == numeric_limits<uint64_t>::max()) return false;
+
+    // El texto del HUD cambia entre niveles; se acepta un error medio moderado
+    const double UMBRAL_ERROR_MEDIO = 24.0;
+    double error_medio = double(mejor.error) / (double(borde.ancho) * borde.alto);
+    if (error_medio > UMBRAL_ERROR_MEDIO) return false;
+
+    canvas_x = mejor.x;
+    canvas_y = mejor.y;
+    return true;
+}
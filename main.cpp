@@ -0,0 +1,133 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "captura.h"
+#include "estabilidad.h"
+#include "grabacion.h"
+#include "clasificador.h"
+
+using namespace std;
+
+// Directorio del ejecutable: solver.py se busca ahí y no en el directorio
+// actual, que puede ser cualquiera (sobre todo con EMBEBER=1)
+static string directorio_ejecutable() {
+    char ruta[4096];
+    ssize_t n = readlink("/proc/self/exe", ruta, sizeof(ruta) - 1);
+    if (n <= 0) return ".";
+    string s(ruta, n);
+    size_t barra = s.find_last_of('/');
+    return barra == string::npos ? "." : s.substr(0, barra);
+}
+
+int main(int argc, char** argv) {
+
+    using namespace chrono;
+    auto start = high_resolution_clock::now(); // Marca el inicio
+
+    // --guardar-captura: además vuelca la captura a captura_firefox.png
+    // --esperar-estable: espera a que termine la animación antes de clasificar
+    // --grabar <archivo>: añade la captura a una grabación (con --esperar-estable,
+    //   todos los fotogramas de la espera)
+    // --reproducir <archivo>: clasifica todos los fotogramas de una grabación (sin Firefox)
+    // --cache-celdas <archivo>: carga y guarda la caché de celdas entre ejecuciones
+    // --lote: con --reproducir, clasifica los fotogramas en lotes (classify_batch)
+    bool guardar_png = false;
+    bool esperar_estable = false;
+    bool en_lote = false;
+    string archivo_grabacion, archivo_reproduccion, archivo_cache;
+    for (int a = 1; a < argc; ++a) {
+        string arg = argv[a];
+        if (arg == "--guardar-captura") guardar_png = true;
+        else if (arg == "--esperar-estable") esperar_estable = true;
+        else if (arg == "--grabar" && a + 1 < argc) archivo_grabacion = argv[++a];
+        else if (arg == "--reproducir" && a + 1 < argc) archivo_reproduccion = argv[++a];
+        else if (arg == "--cache-celdas" && a + 1 < argc) archivo_cache = argv[++a];
+        else if (arg == "--lote") en_lote = true;
+    }
+
+    int filas = 15;
+    int columnas = 10;
+    vector<TileTemplate> plantillas = cargar_plantillas();
+    if (plantillas.empty()) {
+        cerr << "No se pudieron cargar las plantillas" << endl;
+        return 1;
+    }
+    TileClassifier clasificador(move(plantillas), filas, columnas);
+    CacheCeldas& cache = clasificador.cache();
+    if (!archivo_cache.empty()) cache.cargar(archivo_cache);
+
+    Fotograma fotograma;
+    vector<vector<int>> etiquetas;
+
+    if (!archivo_reproduccion.empty()) {
+        // Modo offline: la grabación sustituye a tomar_captura
+        ReproductorFotogramas reproductor;
+        if (!reproductor.abrir(archivo_reproduccion)) return 1;
+        int n = 0;
+        if (en_lote) {
+            // Grabaciones largas: lotes de LOTE fotogramas para acotar la memoria
+            const size_t LOTE = 64;
+            vector<Fotograma> lote(LOTE);
+            auto t0 = high_resolution_clock::now();
+            for (;;) {
+                size_t k = 0;
+                while (k < LOTE && reproductor.siguiente(lote[k])) ++k;
+                if (k == 0) break;
+                lote.resize(k);
+                etiquetas = clasificador.classify_batch(lote).back();
+                n += k;
+                if (k < LOTE) break;
+            }
+            auto t1 = high_resolution_clock::now();
+            cout << n << " fotogramas en lotes de " << LOTE << ": "
+                 << duration_cast<microseconds>(t1 - t0).count() << " us" << endl;
+        }
+        // Fotogramas consecutivos: solo se reclasifican las celdas que cambian
+        while (!en_lote && reproductor.siguiente(fotograma)) {
+            auto t0 = high_resolution_clock::now();
+            etiquetas = clasificador.classify_incremental(fotograma);
+            auto t1 = high_resolution_clock::now();
+            cout << "Fotograma " << n++ << ": " << duration_cast<microseconds>(t1 - t0).count() << " us, "
+                 << clasificador.reclasificadas() << " celdas reclasificadas" << endl;
+        }
+        cout << "Caché de celdas: " << cache.aciertos() << " aciertos, " << cache.fallos() << " fallos, "
+             << cache.tamano() << " entradas" << endl;
+        if (n == 0) {
+            cerr << "La grabación no tiene fotogramas" << endl;
+            return 1;
+        }
+        guardar_matriz_txt(etiquetas, "matriz_clasificacion.txt");
+    } else {
+        // Un solo grabador para toda la captura: con --esperar-estable graba
+        // cada fotograma de la espera y los siguientes al primero van como
+        // delta. Una captura suelta se graba cruda (cada ejecución empieza
+        // con un fotograma clave).
+        GrabadorFotogramas grabador;
+        if (!archivo_grabacion.empty()) grabador.abrir(archivo_grabacion);
+        bool capturado = esperar_estable ? capturar_estable(fotograma, 3, 3000, &grabador)
+                                         : tomar_captura(fotograma) == 0;
+        if (!capturado) {
+            cerr << "No se pudo capturar el tablero" << endl;
+            return 1;
+        }
+        if (guardar_png) guardar_captura_png(fotograma);
+        if (!esperar_estable && grabador.abierto()) grabador.escribir(fotograma);
+
+        etiquetas = clasificador.classify(fotograma);
+        guardar_matriz_txt(etiquetas, "matriz_clasificacion.txt");
+        // El solver lee matriz_clasificacion.txt del directorio actual
+        string solver = "python3 '" + directorio_ejecutable() + "/solver.py'";
+        system(solver.c_str());
+    }
+    if (!archivo_cache.empty()) cache.guardar(archivo_cache);
+
+    auto end = high_resolution_clock::now(); // Marca el final
+    auto duration = duration_cast<milliseconds>(end - start);
+    cout << "Tiempo de ejecución Total Programa: " << duration.count() << " ms" << endl;
+
+    return 0;
+}
\ No newline at end of file
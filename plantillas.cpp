@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "plantillas.h"
+
+using namespace std;
+
+static const char MAGIA[6] = {'D', 'R', 'P', 'A', 'C', 'K'};
+// Hay que subirla si cambia el cálculo de los rasgos: prepro reutiliza los del
+// pack anterior para los tiles que no cambiaron
+static const uint16_t VERSION_PACK = 1;
+static const size_t ALINEACION = 64;
+static const uint32_t MAX_PLANTILLAS = 1u << 20;
+
+struct CabeceraPack {
+    char magia[6];
+    uint16_t version;
+    uint32_t n;
+    uint32_t tam_registro;
+    uint64_t tam_archivo;
+    uint8_t reservado[40];
+};
+static_assert(sizeof(CabeceraPack) == 64, "formato del pack");
+
+// Los histogramas van primero para que cada uno empiece alineado
+struct alignas(64) RegistroPack {
+    int32_t hist_rgb[64];
+    int32_t hist_rgb_norm[64];
+    int32_t hist_central_norm[64];
+    int32_t grueso_rgb[8], grueso_central_norm[8];
+    char nombre[64]; // terminado en cero
+    int32_t w, h, negros, cafes, blancos, otros, tipo, reservado;
+    uint64_t desplazamiento; // de los píxeles, desde el inicio del archivo
+};
+static_assert(sizeof(RegistroPack) % ALINEACION == 0, "formato del pack");
+
+static size_t alinear(size_t n) {
+    return (n + ALINEACION - 1) / ALINEACION * ALINEACION;
+}
+
+void asignar_pixeles(TileTemplate& t, const unsigned char* rgb, int w, int h) {
+    auto copia = make_shared<vector<unsigned char>>(rgb, rgb + (size_t)w * h * 3);
+    t.data = copia->data();
+    t.w = w;
+    t.h = h;
+    t.c = 3;
+    t.memoria = move(copia);
+}
+
+void precalcular_rasgos(TileTemplate& t) {
+    VistaImagen vista = vista_plantilla(t);
+    histograma(vista, t.negros, t.cafes, t.blancos, t.otros);
+    calcular_histograma_rgb(vista, t.hist_rgb);
+    t.hist_rgb_norm = t.hist_rgb;
+    normalizar_histograma(t.hist_rgb_norm);
+    histograma_central_norm(vista, t.hist_central_norm);
+    engrosar_histograma(t.hist_rgb, t.grueso_rgb);
+    engrosar_histograma(t.hist_central_norm, t.grueso_central_norm);
+}
+
+// Tipo de casilla de cada plantilla. La 32 aparece dos veces; vale la primera
+// (piso), igual que al construir un unordered_map con esta lista.
+static constexpr pair<int, int> tile_to_tipo[] = {
+    {3, 1}, {4, 1}, {11, 1}, {12, 1}, {13, 1}, {14, 1}, {15, 1}, {16, 1}, {39, 1},  // pared
+    {7, 0}, {30, 0}, {32, 0}, {38, 0}, {40, 0}, {41, 0}, {42, 0}, {44, 0}, // piso
+    {0, 2},  // diamante
+    {2, 3},  // llave
+    {5, 4},  // personaje
+    {8, 5},  // puerta
+    {6, 6},  // piedra
+    {9, 7}, {25, 7}, {17, 7}, //pinchos
+    {10, 8}, // salida
+    {1, 9}, {43, 9}, // hueco
+    {18, 10}, {19, 10}, {20, 10}, {21, 10}, {22, 10}, {23, 10}, {24, 10},  // lava
+    {26, 11},  // reja
+    {27, 12},  // boton
+    {28, 13},  // estatua
+    {29, 14},  // pinchos - afuera
+    {31, 15},  // personaje con llave
+    {32, 16},  // piedra en hueco
+    {33, 17},  // reja abajo
+    {34, 18},  // piedra en boton
+    {35, 19},  // personaje en boton
+    {36, 20},  // Piedra en pinchos
+    {37, 21},  // Personaje - Boton - Llaves
+
+};
+
+static constexpr int plantillas_con_tipo() {
+    int n = 0;
+    for (const auto& par : tile_to_tipo) n = max(n, par.first + 1);
+    return n;
+}
+
+// Tabla índice de plantilla -> tipo, resuelta al compilar; las plantillas sin
+// tipo se quedan con su índice
+static constexpr array<int, plantillas_con_tipo()> construir_tabla_tipos() {
+    array<int, plantillas_con_tipo()> tabla = {};
+    for (size_t t = 0; t < tabla.size(); ++t) tabla[t] = -1;
+    for (const auto& par : tile_to_tipo)
+        if (tabla[par.first] < 0) tabla[par.first] = par.second;
+    for (size_t t = 0; t < tabla.size(); ++t)
+        if (tabla[t] < 0) tabla[t] = t;
+    return tabla;
+}
+
+static constexpr auto tabla_tipos = construir_tabla_tipos();
+static_assert(tabla_tipos[32] == 0, "la plantilla 32 es piso");
+
+int tipo_de_plantilla(int t) {
+    return t >= 0 && t < (int)tabla_tipos.size() ? tabla_tipos[t] : t;
+}
+
+int numero_de_plantilla(const string& nombre) {
+    size_t barra = nombre.find_last_of('/');
+    string archivo = barra == string::npos ? nombre : nombre.substr(barra + 1);
+    const string prefijo = "tile", sufijo = ".png";
+    if (archivo.size() <= prefijo.size() + sufijo.size() || archivo.compare(0, prefijo.size(), prefijo) != 0 ||
+        archivo.compare(archivo.size() - sufijo.size(), sufijo.size(), sufijo) != 0)
+        return -1;
+    string digitos = archivo.substr(prefijo.size(), archivo.size() - prefijo.size() - sufijo.size());
+    if (digitos.size() > 6 || !all_of(digitos.begin(), digitos.end(), ::isdigit)) return -1;
+    return stoi(digitos);
+}
+
+bool plantillas_contiguas(const vector<TileTemplate>& templates) {
+    for (size_t k = 0; k < templates.size(); ++k) {
+        if (numero_de_plantilla(templates[k].name) != (int)k) {
+            cerr << "La plantilla " << k << " es " << templates[k].name << " y no tile" << k
+                 << ".png: falta un tile o no se pudo cargar (regenerar con prepro)" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool guardar_pack_plantillas(const string& archivo, const vector<TileTemplate>& templates) {
+    vector<RegistroPack> registros(templates.size());
+    size_t desplazamiento = sizeof(CabeceraPack) + registros.size() * sizeof(RegistroPack);
+    for (size_t k = 0; k < templates.size(); ++k) {
+        const TileTemplate& t = templates[k];
+        RegistroPack& r = registros[k];
+        memset(&r, 0, sizeof(r));
+        if (t.name.size() >= sizeof(r.nombre) || !t.data) {
+            cerr << "Plantilla no válida para el pack: " << t.name << endl;
+            return false;
+        }
+        copy(t.hist_rgb.begin(), t.hist_rgb.end(), r.hist_rgb);
+        copy(t.hist_rgb_norm.begin(), t.hist_rgb_norm.end(), r.hist_rgb_norm);
+        copy(t.hist_central_norm.begin(), t.hist_central_norm.end(), r.hist_central_norm);
+        copy(t.grueso_rgb.begin(), t.grueso_rgb.end(), r.grueso_rgb);
+        copy(t.grueso_central_norm.begin(), t.grueso_central_norm.end(), r.grueso_central_norm);
+        memcpy(r.nombre, t.name.data(), t.name.size());
+        r.w = t.w;
+        r.h = t.h;
+        r.negros = t.negros;
+        r.cafes = t.cafes;
+        r.blancos = t.blancos;
+        r.otros = t.otros;
+        r.tipo = t.tipo;
+        r.desplazamiento = desplazamiento = alinear(desplazamiento);
+        desplazamiento += (size_t)t.w * t.h * 3;
+    }
+
+    CabeceraPack cabecera;
+    memset(&cabecera, 0, sizeof(cabecera));
+    memcpy(cabecera.magia, MAGIA, sizeof(MAGIA));
+    cabecera.version = VERSION_PACK;
+    cabecera.n = registros.size();
+    cabecera.tam_registro = sizeof(RegistroPack);
+    cabecera.tam_archivo = alinear(desplazamiento);
+
+    // Se escribe a un temporal y se renombra, para no dejar un pack a medias
+    // si algún bot lo está mapeando
+    string temporal = archivo + ".tmp";
+    ofstream salida(temporal, ios::binary | ios::trunc);
+    if (!salida) {
+        cerr << "No se pudo escribir el pack " << archivo << endl;
+        return false;
+    }
+    salida.write((const char*)&cabecera, sizeof(cabecera));
+    salida.write((const char*)registros.data(), registros.size() * sizeof(RegistroPack));
+    static const char ceros[ALINEACION] = {};
+    size_t escrito = sizeof(cabecera) + registros.size() * sizeof(RegistroPack);
+    for (size_t k = 0; k < templates.size(); ++k) {
+        salida.write(ceros, registros[k].desplazamiento - escrito);
+        size_t tam = (size_t)templates[k].w * templates[k].h * 3;
+        salida.write((const char*)templates[k].data, tam);
+        escrito = registros[k].desplazamiento + tam;
+    }
+    salida.write(ceros, cabecera.tam_archivo - escrito);
+    salida.close();
+    if (!salida || rename(temporal.c_str(), archivo.c_str()) != 0) {
+        cerr << "No se pudo escribir el pack " << archivo << endl;
+        remove(temporal.c_str());
+        return false;
+    }
+    return true;
+}
+
+vector<TileTemplate> cargar_pack_plantillas(const string& archivo) {
+    vector<TileTemplate> templates;
+    int fd = open(archivo.c_str(), O_RDONLY);
+    if (fd < 0) return templates;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(CabeceraPack)) {
+        close(fd);
+        cerr << archivo << " no es un pack de plantillas" << endl;
+        return templates;
+    }
+    size_t tam = info.st_size;
+    void* mapa = mmap(nullptr, tam, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapa == MAP_FAILED) {
+        cerr << "No se pudo mapear " << archivo << endl;
+        return templates;
+    }
+    shared_ptr<const void> memoria(mapa, [tam](const void* p) { munmap(const_cast<void*>(p), tam); });
+
+    const unsigned char* base = (const unsigned char*)mapa;
+    const CabeceraPack* cabecera = (const CabeceraPack*)base;
+    if (memcmp(cabecera->magia, MAGIA, sizeof(MAGIA)) != 0 || cabecera->version != VERSION_PACK ||
+        cabecera->tam_registro != sizeof(RegistroPack) || cabecera->tam_archivo != tam ||
+        cabecera->n > MAX_PLANTILLAS ||
+        sizeof(CabeceraPack) + (size_t)cabecera->n * sizeof(RegistroPack) > tam) {
+        cerr << archivo << " no es un pack de plantillas compatible" << endl;
+        return templates;
+    }
+
+    const RegistroPack* registros = (const RegistroPack*)(base + sizeof(CabeceraPack));
+    templates.resize(cabecera->n);
+    for (uint32_t k = 0; k < cabecera->n; ++k) {
+        const RegistroPack& r = registros[k];
+        TileTemplate& t = templates[k];
+        if (r.w <= 0 || r.h <= 0 || r.w > 4096 || r.h > 4096 || r.desplazamiento > tam ||
+            (size_t)r.w * r.h * 3 > tam - r.desplazamiento || !memchr(r.nombre, 0, sizeof(r.nombre))) {
+            cerr << archivo << ": registro " << k << " dañado" << endl;
+            return {};
+        }
+        t.name = r.nombre;
+        t.data = base + r.desplazamiento;
+        t.w = r.w;
+        t.h = r.h;
+        t.c = 3;
+        t.negros = r.negros;
+        t.cafes = r.cafes;
+        t.blancos = r.blancos;
+        t.otros = r.otros;
+        t.tipo = r.tipo;
+        copy(r.hist_rgb, r.hist_rgb + 64, t.hist_rgb.begin());
+        copy(r.hist_rgb_norm, r.hist_rgb_norm + 64, t.hist_rgb_norm.begin());
+        copy(r.hist_central_norm, r.hist_central_norm + 64, t.hist_central_norm.begin());
+        copy(r.grueso_rgb, r.grueso_rgb + 8, t.grueso_rgb.begin());
+        copy(r.grueso_central_norm, r.grueso_central_norm + 8, t.grueso_central_norm.begin());
+        t.memoria = memoria;
+    }
+    return templates;
+}
+
+static void escribir_enteros(ostream& salida, const int* v, int n) {
+    salida << "{";
+    for (int k = 0; k < n; ++k) salida << (k ? ", " : "") << v[k];
+    salida << "}";
+}
+
+static void escribir_bytes(ostream& salida, const unsigned char* datos, size_t n) {
+    for (size_t b = 0; b < n; ++b) salida << (b == 0 ? "\n    " : b % 24 ? "," : ",\n    ") << (int)datos[b];
+}
+
+bool guardar_cabecera_plantillas(const string& archivo, const vector<TileTemplate>& templates,
+                                 const BordeEmbebido& borde) {
+    ostringstream salida;
+    salida << "// Generado por prepro --cabecera a partir de tiles/; no editar.\n"
+              "#ifndef PLANTILLAS_EMBEBIDAS_H\n"
+              "#define PLANTILLAS_EMBEBIDAS_H\n\n"
+              "#include \"plantillas.h\"\n\n";
+    for (size_t k = 0; k < templates.size(); ++k) {
+        const TileTemplate& t = templates[k];
+        size_t tam = (size_t)t.w * t.h * 3;
+        salida << "alignas(64) static constexpr unsigned char pixeles_plantilla_" << k << "[" << tam << "] = {";
+        escribir_bytes(salida, t.data, tam);
+        salida << "\n};\n\n";
+    }
+    salida << "static constexpr PlantillaEmbebida plantillas_embebidas[] = {\n";
+    for (size_t k = 0; k < templates.size(); ++k) {
+        const TileTemplate& t = templates[k];
+        salida << "    {\"" << t.name << "\", " << t.w << ", " << t.h << ", " << t.negros << ", " << t.cafes << ", "
+               << t.blancos << ", " << t.otros << ", " << t.tipo << ", pixeles_plantilla_" << k << ",\n     ";
+        escribir_enteros(salida, t.hist_rgb.data(), 64);
+        salida << ",\n     ";
+        escribir_enteros(salida, t.hist_rgb_norm.data(), 64);
+        salida << ",\n     ";
+        escribir_enteros(salida, t.hist_central_norm.data(), 64);
+        salida << ",\n     ";
+        escribir_enteros(salida, t.grueso_rgb.data(), 8);
+        salida << ", ";
+        escribir_enteros(salida, t.grueso_central_norm.data(), 8);
+        salida << "},\n";
+    }
+    salida << "};\n\n";
+    if (borde.w > 0) {
+        size_t tam = (size_t)borde.w * borde.h * 3;
+        salida << "alignas(64) static constexpr unsigned char pixeles_borde[" << tam << "] = {";
+        escribir_bytes(salida, borde.pixeles, tam);
+        salida << "\n};\n\nstatic constexpr BordeEmbebido borde_embebido = {" << borde.w << ", " << borde.h
+               << ", pixeles_borde};\n\n";
+    } else {
+        salida << "static constexpr BordeEmbebido borde_embebido = {0, 0, nullptr};\n\n";
+    }
+    salida << "#endif\n";
+
+    // Solo se reescribe si cambia, para no recompilar el clasificador sin motivo
+    ifstream anterior(archivo, ios::binary);
+    if (anterior) {
+        ostringstream contenido;
+        contenido << anterior.rdbuf();
+        if (contenido.str() == salida.str()) return true;
+    }
+    ofstream fout(archivo, ios::binary | ios::trunc);
+    if (!fout || !fout.write(salida.str().data(), salida.str().size())) {
+        cerr << "No se pudo escribir " << archivo << endl;
+        return false;
+    }
+    return true;
+}
+
+vector<TileTemplate> cargar_plantillas_embebidas(const PlantillaEmbebida* plantillas, size_t n) {
+    vector<TileTemplate> templates(n);
+    for (size_t k = 0; k < n; ++k) {
+        const PlantillaEmbebida& e = plantillas[k];
+        TileTemplate& t = templates[k];
+        t.name = e.nombre;
+        t.data = e.pixeles;
+        t.w = e.w;
+        t.h = e.h;
+        t.c = 3;
+        t.negros = e.negros;
+        t.cafes = e.cafes;
+        t.blancos = e.blancos;
+        t.otros = e.otros;
+        t.tipo = e.tipo;
+        copy(e.hist_rgb, e.hist_rgb + 64, t.hist_rgb.begin());
+        copy(e.hist_rgb_norm, e.hist_rgb_norm + 64, t.hist_rgb_norm.begin());
+        copy(e.hist_central_norm, e.hist_central_norm + 64, t.hist_central_norm.begin());
+        copy(e.grueso_rgb, e.grueso_rgb + 8, t.grueso_rgb.begin());
+        copy(e.grueso_central_norm, e.grueso_central_norm + 8, t.grueso_central_norm.begin());
+    }
+    return templates;
+}
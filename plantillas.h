@@ -0,0 +1,89 @@
+#ifndef PLANTILLAS_H
+#define PLANTILLAS_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rasgos.h"
+
+// Estructura básica para las plantillas
+struct TileTemplate {
+    std::string name;
+    const unsigned char* data; // w * h píxeles RGB, propiedad de 'memoria'
+    int w, h, c;
+    int negros, cafes, blancos, otros; // histogramas preprocesados
+    int tipo;                          // tipo de casilla (tipo_de_plantilla)
+
+    // Rasgos fijos de la plantilla, calculados una vez al cargarla
+    Histograma64 hist_rgb;          // 64 bins de la celda completa
+    Histograma64 hist_rgb_norm;     // el mismo, normalizado
+    Histograma64 hist_central_norm; // región central (ver region_central_bloqueado), normalizado
+    Histograma8 grueso_rgb, grueso_central_norm; // versiones de 8 bins (engrosar_histograma)
+
+    // Dueño de los píxeles: una copia propia o el pack mapeado en memoria
+    std::shared_ptr<const void> memoria;
+};
+
+inline VistaImagen vista_plantilla(const TileTemplate& t) {
+    return {t.data, t.w, t.h, t.w * 3, 3};
+}
+
+// Copia 'rgb' (w * h píxeles) como píxeles de la plantilla
+void asignar_pixeles(TileTemplate& t, const unsigned char* rgb, int w, int h);
+// Todos los rasgos que usa el clasificador: conteos de color e histogramas
+void precalcular_rasgos(TileTemplate& t);
+
+// Tipo de casilla de la plantilla de índice 't'
+int tipo_de_plantilla(int t);
+
+// Índice N de la plantilla tileN.png (con o sin directorio); -1 si el nombre
+// no tiene esa forma
+int numero_de_plantilla(const std::string& nombre);
+
+// El clasificador busca algunas plantillas por posición (5, 35, 29, 33) y
+// tipo_de_plantilla va por índice, así que la plantilla k tiene que ser
+// tilek.png para todo k. Si no, lo dice por cerr y devuelve false.
+bool plantillas_contiguas(const std::vector<TileTemplate>& templates);
+
+// Pack binario de plantillas que genera prepro. Se mapea en memoria tal cual:
+// los píxeles RGB y los histogramas ya calculados se usan sin decodificar PNG
+// ni leer texto.
+//
+// Archivo (orden de bytes nativo):
+//   cabecera de 64 bytes: "DRPACK", versión (uint16), número de plantillas
+//   (uint32), tamaño de registro (uint32) y tamaño total (uint64);
+//   un registro por plantilla, alineado a 64 bytes: histogramas, nombre,
+//   dimensiones, conteos de color, tipo y desplazamiento de sus píxeles;
+//   los píxeles de cada plantilla, empezando en múltiplo de 64 bytes.
+bool guardar_pack_plantillas(const std::string& archivo, const std::vector<TileTemplate>& templates);
+
+// Vacío si el pack no existe o no es compatible
+std::vector<TileTemplate> cargar_pack_plantillas(const std::string& archivo);
+
+// Plantilla compilada dentro del binario (make EMBEBER=1). prepro --cabecera
+// genera plantillas_embebidas.h con un arreglo constexpr de estas, con los
+// píxeles y los rasgos ya calculados.
+struct PlantillaEmbebida {
+    const char* nombre;
+    int w, h, negros, cafes, blancos, otros, tipo;
+    const unsigned char* pixeles;
+    int hist_rgb[64], hist_rgb_norm[64], hist_central_norm[64];
+    int grueso_rgb[8], grueso_central_norm[8];
+};
+
+// Franja de referencia del localizador del canvas (cargar_borde_referencia en
+// captura.h), que también va en el header para no depender de niveles/ al
+// ejecutar. w = 0 si prepro no la encontró.
+struct BordeEmbebido {
+    int w, h;
+    const unsigned char* pixeles; // RGB
+};
+
+bool guardar_cabecera_plantillas(const std::string& archivo, const std::vector<TileTemplate>& templates,
+                                 const BordeEmbebido& borde = {0, 0, nullptr});
+
+// Las plantillas apuntan a los arreglos estáticos, sin copiarlos
+std::vector<TileTemplate> cargar_plantillas_embebidas(const PlantillaEmbebida* plantillas, size_t n);
+
+#endif
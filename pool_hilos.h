@@ -0,0 +1,101 @@
+#ifndef POOL_HILOS_H
+#define POOL_HILOS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Hilos de trabajo persistentes: se crean una vez y cada ejecutar() reparte
+// tareas entre ellos y el hilo que llama, sin levantar una región paralela
+// nueva por fotograma.
+class PoolHilos {
+public:
+    // 'hilos' cuenta también el que llama a ejecutar()
+    explicit PoolHilos(int hilos) {
+        for (int h = 1; h < hilos; ++h) trabajadores.emplace_back(&PoolHilos::bucle, this, h);
+    }
+
+    ~PoolHilos() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            salir = true;
+        }
+        cv_inicio.notify_all();
+        for (std::thread& t : trabajadores) t.join();
+    }
+
+    PoolHilos(const PoolHilos&) = delete;
+    PoolHilos& operator=(const PoolHilos&) = delete;
+
+    int tamano() const { return (int)trabajadores.size() + 1; }
+
+    // Llama a tarea(k, hilo) para cada k en [0, n) y vuelve cuando acaban
+    // todas. 'tarea' se pasa por referencia, sin envolverla en std::function,
+    // así que repartir no reserva memoria.
+    template <class Tarea>
+    void ejecutar(int n, const Tarea& tarea) {
+        if (trabajadores.empty() || n <= 1) {
+            for (int k = 0; k < n; ++k) tarea(k, 0);
+            return;
+        }
+        lanzar(n, &tarea, [](const void* contexto, int k, int hilo) {
+            (*static_cast<const Tarea*>(contexto))(k, hilo);
+        });
+    }
+
+private:
+    typedef void (*Invocar)(const void*, int, int);
+
+    void lanzar(int n, const void* contexto, Invocar invocar) {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            actual = contexto;
+            invocar_actual = invocar;
+            n_tareas = n;
+            siguiente.store(0, std::memory_order_relaxed);
+            activos = (int)trabajadores.size();
+            ++generacion;
+        }
+        cv_inicio.notify_all();
+        repartir(0);
+        std::unique_lock<std::mutex> lock(m);
+        cv_fin.wait(lock, [this] { return activos == 0; });
+        actual = nullptr;
+    }
+
+    void repartir(int hilo) {
+        for (int k; (k = siguiente.fetch_add(1, std::memory_order_relaxed)) < n_tareas;)
+            invocar_actual(actual, k, hilo);
+    }
+
+    void bucle(int hilo) {
+        uint64_t vista = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv_inicio.wait(lock, [&] { return salir || generacion != vista; });
+                if (salir) return;
+                vista = generacion;
+            }
+            repartir(hilo);
+            std::lock_guard<std::mutex> lock(m);
+            if (--activos == 0) cv_fin.notify_one();
+        }
+    }
+
+    std::vector<std::thread> trabajadores;
+    std::mutex m;
+    std::condition_variable cv_inicio, cv_fin;
+    const void* actual = nullptr;        // la tarea de ejecutar()
+    Invocar invocar_actual = nullptr;
+    int n_tareas = 0;
+    std::atomic<int> siguiente{0};
+    int activos = 0;
+    uint64_t generacion = 0;
+    bool salir = false;
+};
+
+#endif
@@ -1,54 +1,207 @@
+// Preprocesado de las plantillas de tiles/: calcula los rasgos de cada tile y
+// genera plantillas_preprocesadas.txt y plantillas.pack (ver plantillas.h).
+//
+// Los tiles se descubren por nombre (tileN.png, en orden numérico; N es el
+// índice de plantilla, así que no puede faltar ninguno) y se procesan en
+// paralelo. plantillas.manifiesto guarda el hash del PNG de cada tile con el
+// que se generó el pack, así que en la siguiente ejecución los tiles que no
+// cambiaron se copian del pack anterior sin decodificarlos.
+//
+// Uso: ./prepro [--todo] [--cabecera plantillas_embebidas.h]
+//   --todo      recalcula todos los tiles aunque no hayan cambiado
+//   --cabecera  además genera el header para compilar con EMBEBER=1 (con la
+//               franja del localizador, de niveles/nivel2.png)
+
+#include <cstdio>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <string>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <omp.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#include "hash64.h"
+#include "plantillas.h"
 
 using namespace std;
+namespace fs = std::filesystem;
+
+static const char* DIRECTORIO_TILES = "tiles";
+static const char* ARCHIVO_PACK = "plantillas.pack";
+static const char* ARCHIVO_MANIFIESTO = "plantillas.manifiesto";
+static const char* ARCHIVO_NIVEL_BORDE = "niveles/nivel2.png";
+static const int VERSION_MANIFIESTO = 1;
+
+struct Tile {
+    int numero;
+    string nombre;   // ruta relativa, p. ej. tiles/tile3.png
+    uint64_t hash = 0;
+    bool ok = false;
+    TileTemplate plantilla = {};
+};
 
-// Devuelve true si el color está dentro del rango de café
-bool es_color_cafe(unsigned char r, unsigned char g, unsigned char b) {
-    return (r >= 40 && r <= 90) && (g >= 25 && g <= 65) && (b >= 20 && b <= 50);
+static vector<Tile> buscar_tiles() {
+    vector<Tile> tiles;
+    error_code error;
+    for (const fs::directory_entry& e : fs::directory_iterator(DIRECTORIO_TILES, error)) {
+        if (!e.is_regular_file()) continue;
+        int n = numero_de_plantilla(e.path().filename().string());
+        if (n >= 0) tiles.push_back({n, string(DIRECTORIO_TILES) + "/tile" + to_string(n) + ".png"});
+    }
+    if (error) cerr << "No se pudo leer " << DIRECTORIO_TILES << ": " << error.message() << endl;
+    sort(tiles.begin(), tiles.end(), [](const Tile& a, const Tile& b) { return a.numero < b.numero; });
+    return tiles;
 }
 
-void histograma(const vector<unsigned char>& img, int& negros, int& cafes, int& blancos, int& otros) {
-    negros = cafes = blancos = otros = 0;
-    for (size_t i = 0; i < img.size(); i += 3) {
-        unsigned char r = img[i], g = img[i+1], b = img[i+2];
-        if (r < 40 && g < 40 && b < 40)
-            negros++;
-        else if (es_color_cafe(r, g, b))
-            cafes++;
-        else
-            otros++;
+// nombre -> hash del PNG con el que se generó el pack anterior
+static map<string, uint64_t> leer_manifiesto() {
+    map<string, uint64_t> hashes;
+    ifstream fin(ARCHIVO_MANIFIESTO);
+    string linea;
+    int version = 0;
+    if (!getline(fin, linea) || sscanf(linea.c_str(), "prepro-manifiesto %d", &version) != 1 ||
+        version != VERSION_MANIFIESTO)
+        return hashes;
+    while (getline(fin, linea)) {
+        istringstream campos(linea);
+        string nombre, hash;
+        if (campos >> nombre >> hash) hashes[nombre] = stoull(hash, nullptr, 16);
     }
+    return hashes;
 }
 
-int main() {
-    int cant_tiles = 45;
-    ofstream fout("plantillas_preprocesadas.txt");
-    if (!fout) {
-        cerr << "No se pudo abrir el archivo de salida." << endl;
+static bool escribir_manifiesto(const vector<Tile>& tiles) {
+    ofstream fout(ARCHIVO_MANIFIESTO, ios::trunc);
+    fout << "prepro-manifiesto " << VERSION_MANIFIESTO << "\n";
+    for (const Tile& t : tiles) {
+        char hash[17];
+        snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)t.hash);
+        fout << t.nombre << " " << hash << "\n";
+    }
+    return (bool)fout;
+}
+
+static bool leer_archivo(const string& nombre, vector<unsigned char>& bytes) {
+    ifstream fin(nombre, ios::binary);
+    if (!fin) return false;
+    bytes.assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+    return true;
+}
+
+int main(int argc, char** argv) {
+    string cabecera;
+    bool todo = false;
+    for (int a = 1; a < argc; ++a) {
+        string arg = argv[a];
+        if (arg == "--cabecera" && a + 1 < argc) cabecera = argv[++a];
+        else if (arg == "--todo") todo = true;
+    }
+
+    auto inicio = chrono::steady_clock::now();
+    vector<Tile> tiles = buscar_tiles();
+    if (tiles.empty()) {
+        cerr << "No hay tiles en " << DIRECTORIO_TILES << "/" << endl;
         return 1;
     }
+    // El índice de cada plantilla es su número de tile (ver plantillas_contiguas):
+    // con un hueco, las de después quedarían desplazadas
+    for (size_t k = 0; k < tiles.size(); ++k)
+        if (tiles[k].numero != (int)k) {
+            cerr << "Falta " << DIRECTORIO_TILES << "/tile" << k << ".png" << endl;
+            return 1;
+        }
+
+    // Plantillas del pack anterior que se pueden reutilizar
+    map<string, uint64_t> manifiesto;
+    map<string, const TileTemplate*> anteriores;
+    vector<TileTemplate> pack_anterior;
+    if (!todo) {
+        manifiesto = leer_manifiesto();
+        if (!manifiesto.empty()) pack_anterior = cargar_pack_plantillas(ARCHIVO_PACK);
+        for (const TileTemplate& t : pack_anterior) anteriores[t.name] = &t;
+    }
+
+    int reutilizados = 0;
+    #pragma omp parallel for schedule(dynamic) reduction(+ : reutilizados)
+    for (size_t k = 0; k < tiles.size(); ++k) {
+        Tile& tile = tiles[k];
+        vector<unsigned char> png;
+        if (!leer_archivo(tile.nombre, png)) {
+            #pragma omp critical
+            cerr << "No se pudo leer " << tile.nombre << endl;
+            continue;
+        }
+        tile.hash = hash64(png.data(), png.size());
+
+        auto m = manifiesto.find(tile.nombre);
+        auto a = anteriores.find(tile.nombre);
+        if (m != manifiesto.end() && m->second == tile.hash && a != anteriores.end() &&
+            a->second->tipo == tipo_de_plantilla(tile.numero)) {
+            tile.plantilla = *a->second;
+            tile.ok = true;
+            ++reutilizados;
+            continue;
+        }
 
-    for (int i = 0; i < cant_tiles; ++i) {
-        string fname = "tiles/tile" + to_string(i) + ".png";
         int w, h, c;
-        unsigned char* data = stbi_load(fname.c_str(), &w, &h, &c, 3);
+        unsigned char* data = stbi_load_from_memory(png.data(), png.size(), &w, &h, &c, 3);
         if (!data) {
-            cerr << "No se pudo cargar " << fname << endl;
+            #pragma omp critical
+            cerr << "No se pudo cargar " << tile.nombre << endl;
             continue;
         }
-        vector<unsigned char> img(data, data + w * h * 3);
-        int n, caf, bla, o;
-        histograma(img, n, caf, bla, o);
-        fout << fname << " " << w << " " << h << " " << n << " " << caf << " " << bla << " " << o << "\n";
+        TileTemplate& t = tile.plantilla;
+        t.name = tile.nombre;
+        t.tipo = tipo_de_plantilla(tile.numero);
+        asignar_pixeles(t, data, w, h);
         stbi_image_free(data);
+        precalcular_rasgos(t);
+        tile.ok = true;
+    }
+
+    // Igual con un tile que no se pudo leer: no se genera nada
+    for (const Tile& tile : tiles)
+        if (!tile.ok) return 1;
+
+    vector<TileTemplate> templates;
+    ofstream fout("plantillas_preprocesadas.txt");
+    if (!fout) {
+        cerr << "No se pudo abrir el archivo de salida." << endl;
+        return 1;
+    }
+    for (Tile& tile : tiles) {
+        const TileTemplate& t = tile.plantilla;
+        fout << t.name << " " << t.w << " " << t.h << " " << t.negros << " " << t.cafes << " " << t.blancos << " " << t.otros << "\n";
+        templates.push_back(t);
     }
     fout.close();
-    cout << "Preprocesamiento terminado. Archivo: plantillas_preprocesadas.txt" << endl;
+
+    // Mismas plantillas con píxeles e histogramas listos para mapear. El pack
+    // anterior puede seguir mapeado (pack_anterior): se reemplaza con rename.
+    if (!guardar_pack_plantillas(ARCHIVO_PACK, templates)) return 1;
+    escribir_manifiesto(tiles);
+    if (!cabecera.empty()) {
+        // La franja del localizador: las dos filas de tiles de arriba del
+        // nivel, como en cargar_borde_referencia
+        int w = 0, h = 0, c;
+        unsigned char* nivel = stbi_load(ARCHIVO_NIVEL_BORDE, &w, &h, &c, 3);
+        BordeEmbebido borde = {0, 0, nullptr};
+        if (nivel) borde = {w, min(h, 2 * 43), nivel};
+        else cerr << "Sin " << ARCHIVO_NIVEL_BORDE << ": el binario usará la región fija del canvas" << endl;
+        bool ok = guardar_cabecera_plantillas(cabecera, templates, borde);
+        if (nivel) stbi_image_free(nivel);
+        if (!ok) return 1;
+    }
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - inicio).count();
+    cout << "Preprocesamiento terminado: " << templates.size() << " plantillas (" << templates.size() - reutilizados
+         << " calculadas, " << reutilizados << " sin cambios) con " << omp_get_max_threads() << " hilos en " << ms
+         << " ms. Archivos: plantillas_preprocesadas.txt, " << ARCHIVO_PACK << endl;
     return 0;
-}
\ No newline at end of file
+}
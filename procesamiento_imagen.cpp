@@ -1,5 +1,7 @@
 #include <iostream>
 #include <vector>
+#include <array>
+#include <algorithm>
 #include <string>
 #include <cmath>
 #include <limits>
@@ -7,31 +9,37 @@
 #include <iomanip>
 #include <fstream>
 #include <sstream>
+#include <cstring>
 #include <chrono> // Agrega esto al inicio del archivo
 #include <omp.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "stb_image_write.h"
+#include "captura.h"
+#include "estabilidad.h"
+#include "grabacion.h"
+#include "cache_celdas.h"
+#include "hash64.h"
+#include "plantillas.h"
+#include "clasificador.h"
+#ifdef PLANTILLAS_EMBEBIDAS
+#include "plantillas_embebidas.h"
+#endif
 
 using namespace std;
 
-// Estructura básica para las plantillas
-struct TileTemplate {
-    string name;
-    vector<unsigned char> data;
-    int w, h, c;
-    int negros, cafes, blancos, otros; // histogramas preprocesados
-};
-
 struct ColorRange {
     int r_min, r_max;
     int g_min, g_max;
     int b_min, b_max;
 };
 
-int tomar_captura();
-
 // Funciones de carga de imágenes
 unsigned char* cargar_imagen(const string& filename, int& width, int& height, int& channels) {
     unsigned char* img = stbi_load(filename.c_str(), &width, &height, &channels, 3);
@@ -41,6 +49,16 @@ unsigned char* cargar_imagen(const string& filename, int& width, int& height, in
     return img;
 }
 
+bool cargar_fotograma(const string& filename, Fotograma& fotograma) {
+    int width, height, channels;
+    unsigned char* img = cargar_imagen(filename, width, height, channels);
+    if (!img) return false;
+    fotograma.reservar(width, height, FormatoPixel::RGB);
+    memcpy(fotograma.datos(), img, (size_t)width * height * 3);
+    stbi_image_free(img);
+    return true;
+}
+
 // Nueva función para leer los histogramas preprocesados
 vector<TileTemplate> cargar_plantillas_preprocesadas(const string& archivo, int cantidad) {
     vector<TileTemplate> templates;
@@ -49,7 +67,7 @@ vector<TileTemplate> cargar_plantillas_preprocesadas(const string& archivo, int
         cerr << "No se pudo abrir " << archivo << endl;
         return templates;
     }
-    for (int i = 0; i < cantidad; ++i) {
+    for (int i = 0; cantidad < 0 || i < cantidad; ++i) {
         string fname;
         int w, h, n, caf, bla, o;
         if (!(fin >> fname >> w >> h >> n >> caf >> bla >> o)) break;
@@ -57,415 +75,616 @@ vector<TileTemplate> cargar_plantillas_preprocesadas(const string& archivo, int
         // Si necesitas la imagen para comparar píxel a píxel:
         int tw, th, tc;
         unsigned char* tdata = cargar_imagen(fname, tw, th, tc);
-        vector<unsigned char> data;
+        TileTemplate t = {fname, nullptr, w, h, c, n, caf, bla, o, tipo_de_plantilla(numero_de_plantilla(fname)), {}, {}, {}, {}, {}, nullptr};
         if (tdata) {
-            data.assign(tdata, tdata + tw * th * 3);
+            asignar_pixeles(t, tdata, tw, th);
             stbi_image_free(tdata);
         }
-        templates.push_back({fname, data, w, h, c, n, caf, bla, o});
+        precalcular_rasgos(t);
+        templates.push_back(move(t));
     }
     return templates;
 }
 
-// Extrae una celda de la imagen
-vector<unsigned char> extraer_celda(const unsigned char* img, int img_w, int img_h, 
-                                  int block_w, int block_h, int i, int j) {
-    vector<unsigned char> cell(block_w * block_h * 3);
-    for (int y = 0; y < block_h; ++y) {
-        for (int x = 0; x < block_w; ++x) {
-            int src_idx = ((i * block_h + y) * img_w + (j * block_w + x)) * 3;
-            int dst_idx = (y * block_w + x) * 3;
-            for (int k = 0; k < 3; ++k) {
-                cell[dst_idx + k] = img[src_idx + k];
-            }
-        }
-    }
-    return cell;
+vector<TileTemplate> cargar_plantillas() {
+#ifdef PLANTILLAS_EMBEBIDAS
+    // Compiladas en el binario: no se lee nada de disco
+    vector<TileTemplate> plantillas = cargar_plantillas_embebidas(plantillas_embebidas, size(plantillas_embebidas));
+#else
+    // El pack de prepro se mapea tal cual; sin él se decodifican los PNG. En
+    // los dos están todos los tiles que encontró prepro.
+    vector<TileTemplate> plantillas = cargar_pack_plantillas("plantillas.pack");
+    if (plantillas.empty())
+        plantillas = cargar_plantillas_preprocesadas("plantillas_preprocesadas.txt");
+#endif
+    if (!plantillas_contiguas(plantillas)) plantillas.clear();
+    return plantillas;
 }
 
-// Devuelve true si el color está dentro del rango de café
-bool es_color_cafe(unsigned char r, unsigned char g, unsigned char b) {
-    return (r >= 40 && r <= 90) && (g >= 25 && g <= 65) && (b >= 20 && b <= 50);
+// Celda (i, j) del fotograma. La última columna se sale por la derecha
+// (10 * 43 > 427) y lee el inicio de la fila siguiente; la última fila cae en
+// el margen en cero del fotograma.
+VistaImagen vista_celda(const Fotograma& fotograma, int block_w, int block_h, int i, int j) {
+    int canales = fotograma.canales();
+    const unsigned char* origen = fotograma.datos() + (size_t)(i * block_h) * fotograma.stride +
+                                  (size_t)(j * block_w) * canales;
+    return {origen, block_w, block_h, fotograma.stride, canales};
 }
 
-int es_personaje(const vector<unsigned char>& cell) {
-    bool blanco = false;
-    bool beige = false;
-    bool boton = false;
-    bool llave = false;
-    for (size_t i = 0; i < cell.size(); i += 3) {
-        unsigned char r = cell[i], g = cell[i+1], b = cell[i+2];
-        if (r == 230 && g == 249 && b == 255) blanco = true;
-        else if (r == 206 && g == 182 && b == 146) beige = true;
-        else if (r == 117 && g == 80 && b == 61) boton = true;
-        else if (r == 20 && g == 121 && b == 90) llave = true;
-        if (blanco && beige && boton) return 19; // Personaje con botón
-        if (blanco && llave) return 15; // Personaje con llave
-        if (blanco && beige) return 4; // Si ambos colores están presentes, es un personaje
-    }
-    return -1; 
+// Clases de color que consulta la clasificación, como bits
+enum ClaseColor : uint16_t {
+    COLOR_NEGRO        = 1 << 0,  // r, g, b < 40
+    COLOR_CAFE         = 1 << 1,  // es_color_cafe (excluye negro)
+    COLOR_BLANCO       = 1 << 2,  // personaje
+    COLOR_BEIGE        = 1 << 3,  // personaje
+    COLOR_BOTON        = 1 << 4,  // botón bajo personaje o piedra
+    COLOR_LLAVE        = 1 << 5,  // personaje con llave
+    COLOR_PIEDRA_NEGRO = 1 << 6,  // sombra de piedra sobre pinchos / botón
+    COLOR_DIAMANTE     = 1 << 7,
+    COLOR_PISO         = 1 << 8,
+    COLOR_PARED        = 1 << 9,
+    COLOR_GRIS_SALIDA  = 1 << 10,
+    COLOR_CAFE_SALIDA  = 1 << 11,
+};
+
+// Cada clase es un producto de rangos por canal (el diamante admite g = 76 o
+// g = 78, de ahí sus dos cajas). Negro y café, igual que gris y café de la
+// salida, no se solapan, así que los "else if" originales no cambian nada.
+struct CajaColor {
+    uint16_t clase;
+    uint8_t r0, r1, g0, g1, b0, b1;
+};
+
+static const CajaColor cajas_color[] = {
+    {COLOR_NEGRO,          0,  39,   0,  39,   0,  39},
+    {COLOR_CAFE,          40,  90,  25,  65,  20,  50},  // es_color_cafe
+    {COLOR_BLANCO,       230, 230, 249, 249, 255, 255},
+    {COLOR_BEIGE,        206, 206, 182, 182, 146, 146},
+    {COLOR_BOTON,        117, 117,  80,  80,  61,  61},
+    {COLOR_LLAVE,         20,  20, 121, 121,  90,  90},
+    {COLOR_PIEDRA_NEGRO,  16,  16,   9,   9,   5,   5},
+    {COLOR_DIAMANTE,      66,  67,  76,  76,  63,  64},
+    {COLOR_DIAMANTE,      66,  67,  78,  78,  63,  64},
+    {COLOR_PISO,          63,  63,  40,  40,  28,  28},
+    {COLOR_PARED,         38,  38,  38,  38,  38,  38},
+    {COLOR_GRIS_SALIDA,  155, 162, 150, 160, 150, 160},
+    {COLOR_CAFE_SALIDA,   95, 106,  45,  55,  15,  24},
+};
+
+// Tabla RGB -> clases. Como todas las clases son productos por canal, la
+// tabla de 2^24 entradas se separa en tres de 256:
+// clases(r, g, b) = r[r] & g[g] & b[b]
+struct TablaColores {
+    uint16_t r[256] = {}, g[256] = {}, b[256] = {};
+
+    TablaColores() {
+        for (const CajaColor& c : cajas_color) {
+            for (int v = c.r0; v <= c.r1; ++v) r[v] |= c.clase;
+            for (int v = c.g0; v <= c.g1; ++v) g[v] |= c.clase;
+            for (int v = c.b0; v <= c.b1; ++v) b[v] |= c.clase;
+        }
+    }
+
+    uint16_t operator()(unsigned char rr, unsigned char gg, unsigned char bb) const {
+        return r[rr] & g[gg] & b[bb];
+    }
+};
+
+static const TablaColores tabla_colores;
+
+// Plantilla de menor chi2 (la de menor índice si hay empate), igual que el
+// recorrido lineal pero con poda: las plantillas se visitan por su cota
+// gruesa, se para en cuanto la cota supera al mejor y cada chi2 deja de sumar
+// al pasarlo. 'central' elige los histogramas de bloque bloqueado.
+int buscar_por_cota_gruesa(const Histograma64& hist, bool central, const vector<TileTemplate>& templates,
+                           vector<pair<double, int>>& orden) {
+    // Holgura para el redondeo y el eps de los denominadores
+    const double HOLGURA = 1.0 - 1e-6;
+
+    Histograma8 grueso;
+    engrosar_histograma(hist, grueso);
+    orden.resize(templates.size());
+    for (size_t t = 0; t < templates.size(); ++t) {
+        const Histograma8& g = central ? templates[t].grueso_central_norm : templates[t].grueso_rgb;
+        orden[t] = {chi2_grueso(grueso, g) * HOLGURA, (int)t};
+    }
+    sort(orden.begin(), orden.end());
+
+    double min_diff = numeric_limits<double>::max();
+    int best_idx = -1;
+    for (const auto& [cota, t] : orden) {
+        if (cota > min_diff) break;
+        const Histograma64& hist_template = central ? templates[t].hist_central_norm : templates[t].hist_rgb;
+        double diff = chi2_hist(hist, hist_template, min_diff);
+        if (diff < min_diff || (diff == min_diff && t < best_idx)) {
+            min_diff = diff;
+            best_idx = t;
+        }
+    }
+    return best_idx;
 }
 
-void histograma(const vector<unsigned char>& img, int& negros, int& cafes, int& blancos, int& otros) {
-    negros = cafes = blancos = otros = 0;
-    for (size_t i = 0; i < img.size(); i += 3) {
-        unsigned char r = img[i], g = img[i+1], b = img[i+2];
-        if (r < 40 && g < 40 && b < 40)
-            negros++;
-        else if (es_color_cafe(r, g, b))
-            cafes++;
-        else
-            otros++;
+// Índice de vecino más cercano sobre los histogramas de las plantillas, para
+// que el coste por celda no crezca linealmente con el número de plantillas.
+// Es un árbol de puntos de referencia (VP-tree) con distancia L2, que sí es
+// métrica. La búsqueda sigue siendo exacta en chi2: cada término cumple
+// (a-b)^2 / (a+b) >= (a-b)^2 / (Na+Nb), con N la suma del histograma, así que
+// chi2 >= L2^2 / (Na+Nb) y una cota de L2 por desigualdad triangular poda
+// subárboles enteros.
+class ArbolVP {
+public:
+    ArbolVP() = default;
+    ArbolVP(const vector<TileTemplate>& templates, bool central) : central(central) {
+        vector<int> indices(templates.size());
+        for (size_t t = 0; t < indices.size(); ++t) indices[t] = t;
+        nodos.reserve(indices.size());
+        raiz = construir(templates, indices, 0, indices.size());
+    }
+
+    bool vacio() const { return nodos.empty(); }
+
+    // Igual que buscar_por_cota_gruesa: menor chi2 y menor índice en empate
+    int mas_cercana(const Histograma64& hist, const vector<TileTemplate>& templates) const {
+        Busqueda b = {hist, total_histograma(hist), numeric_limits<double>::max(), -1};
+        buscar(raiz, templates, b);
+        return b.mejor;
     }
+
+private:
+    struct Nodo {
+        int plantilla;
+        double radio_dentro = 0, radio_fuera = 0; // máx. distancia dentro, mín. fuera
+        int dentro = -1, fuera = -1;
+        int total_max = 0;                         // mayor suma de histograma del subárbol
+    };
+
+    struct Busqueda {
+        const Histograma64& hist;
+        int total;
+        double min_diff;
+        int mejor;
+    };
+
+    const Histograma64& hist_de(const TileTemplate& t) const {
+        return central ? t.hist_central_norm : t.hist_rgb;
+    }
+
+    static int total_histograma(const Histograma64& h) {
+        int n = 0;
+        for (int v : h) n += v;
+        return n;
+    }
+
+    static double distancia(const Histograma64& a, const Histograma64& b) {
+        double d = 0;
+        for (int k = 0; k < 64; ++k) {
+            double x = a[k] - b[k];
+            d += x * x;
+        }
+        return sqrt(d);
+    }
+
+    int construir(const vector<TileTemplate>& templates, vector<int>& indices, size_t ini, size_t fin) {
+        if (ini >= fin) return -1;
+        int id = nodos.size();
+        nodos.push_back(Nodo());
+        nodos[id].plantilla = indices[ini];
+        const Histograma64& vp = hist_de(templates[indices[ini]]);
+        int total_max = total_histograma(vp);
+
+        vector<pair<double, int>> resto;
+        for (size_t k = ini + 1; k < fin; ++k) {
+            resto.push_back({distancia(vp, hist_de(templates[indices[k]])), indices[k]});
+            total_max = max(total_max, total_histograma(hist_de(templates[indices[k]])));
+        }
+        sort(resto.begin(), resto.end());
+        size_t mitad = resto.size() / 2;
+        for (size_t k = 0; k < resto.size(); ++k) indices[ini + 1 + k] = resto[k].second;
+        if (mitad > 0) nodos[id].radio_dentro = resto[mitad - 1].first;
+        if (mitad < resto.size()) nodos[id].radio_fuera = resto[mitad].first;
+        nodos[id].total_max = total_max;
+
+        int dentro = construir(templates, indices, ini + 1, ini + 1 + mitad);
+        int fuera = construir(templates, indices, ini + 1 + mitad, fin);
+        nodos[id].dentro = dentro;
+        nodos[id].fuera = fuera;
+        return id;
+    }
+
+    // Cota inferior del chi2 contra cualquier plantilla del subárbol 'nodo'
+    // sabiendo que su distancia L2 a la consulta es al menos 'l2'
+    double cota_chi2(int nodo, double l2, int total) const {
+        if (l2 <= 0) return 0;
+        return l2 * l2 / (total + nodos[nodo].total_max + 1e-10) * (1.0 - 1e-6);
+    }
+
+    void buscar(int id, const vector<TileTemplate>& templates, Busqueda& b) const {
+        if (id < 0) return;
+        const Nodo& n = nodos[id];
+        const Histograma64& vp = hist_de(templates[n.plantilla]);
+
+        double diff = chi2_hist(b.hist, vp, b.min_diff);
+        if (diff < b.min_diff || (diff == b.min_diff && n.plantilla < b.mejor)) {
+            b.min_diff = diff;
+            b.mejor = n.plantilla;
+        }
+        if (n.dentro < 0 && n.fuera < 0) return;
+
+        double d = distancia(b.hist, vp);
+        double cota_dentro = n.dentro < 0 ? numeric_limits<double>::max()
+                                          : cota_chi2(n.dentro, d - n.radio_dentro, b.total);
+        double cota_fuera = n.fuera < 0 ? numeric_limits<double>::max()
+                                        : cota_chi2(n.fuera, n.radio_fuera - d, b.total);
+        // Primero el lado más prometedor; el otro puede quedar podado
+        if (cota_dentro <= cota_fuera) {
+            if (cota_dentro <= b.min_diff) buscar(n.dentro, templates, b);
+            if (cota_fuera <= b.min_diff) buscar(n.fuera, templates, b);
+        } else {
+            if (cota_fuera <= b.min_diff) buscar(n.fuera, templates, b);
+            if (cota_dentro <= b.min_diff) buscar(n.dentro, templates, b);
+        }
+    }
+
+    bool central = false;
+    vector<Nodo> nodos;
+    int raiz = -1;
+};
+
+// Árboles de las dos búsquedas (celda completa y región central). Con pocas
+// plantillas el recorrido con cota gruesa es más rápido, así que por debajo de
+// MIN_PLANTILLAS no se construyen.
+struct IndicePlantillas {
+    static const size_t MIN_PLANTILLAS = 64;
+    ArbolVP rgb, central;
+
+    IndicePlantillas() = default;
+    explicit IndicePlantillas(const vector<TileTemplate>& templates) {
+        if (templates.size() < MIN_PLANTILLAS) return;
+        rgb = ArbolVP(templates, false);
+        central = ArbolVP(templates, true);
+    }
+};
+
+int contar_diferencias_arbol_vp(const vector<TileTemplate>& templates, const vector<Histograma64>& consultas,
+                                bool central) {
+    ArbolVP arbol(templates, central);
+    vector<pair<double, int>> orden;
+    int diferencias = 0;
+    for (const Histograma64& hist : consultas)
+        if (arbol.mas_cercana(hist, templates) != buscar_por_cota_gruesa(hist, central, templates, orden))
+            ++diferencias;
+    return diferencias;
 }
 
-vector<int> calcular_histograma_rgb(const vector<unsigned char>& img, int bins_per_channel = 4) {
-    int total_bins = bins_per_channel * bins_per_channel * bins_per_channel;
-    vector<int> hist(total_bins, 0);
-    int step = 256 / bins_per_channel;
-    for (size_t i = 0; i < img.size(); i += 3) {
-        int r_bin = img[i] / step;
-        int g_bin = img[i+1] / step;
-        int b_bin = img[i+2] / step;
-        int idx = r_bin * bins_per_channel * bins_per_channel + g_bin * bins_per_channel + b_bin;
-        hist[idx]++;
-    }
-    return hist;
+int plantilla_mas_cercana(const Histograma64& hist, bool central, const vector<TileTemplate>& templates,
+                          const IndicePlantillas* indice, MemoriaCelda& mem) {
+    const ArbolVP* arbol = indice ? (central ? &indice->central : &indice->rgb) : nullptr;
+    if (arbol && !arbol->vacio()) return arbol->mas_cercana(hist, templates);
+    return buscar_por_cota_gruesa(hist, central, templates, mem.orden);
 }
 
-void normalizar_histograma(std::vector<int>& hist) {
-    int total = 0;
-    for (int v : hist) total += v;
-    if (total == 0) return;
-    for (int& v : hist) v = double(v) / total * 1000; // Escala para mantener precisión entera
+// Todo lo que la clasificación necesita de una celda, obtenido leyendo cada
+// píxel una sola vez (ver extraer_rasgos)
+struct RasgosCelda {
+    // Colores exactos del escaneo inicial. El escaneo original se detenía en el
+    // primer píxel de diamante o de salida, así que pared y piso solo cuentan
+    // los píxeles anteriores a ese punto.
+    bool diamante, pared, piso, salida;
+    int personaje;                 // 19, 15, 4 o -1 (sin personaje)
+    int negros, cafes, otros;      // histograma de 4 clases
+    Histograma64 hist;             // 64 bins de la celda completa
+    Histograma64 hist_central;     // región central de bloqueado, sin normalizar
+    bool piedra_negro, piedra_cafe; // colores de la región de piedra
+};
+
+// Región donde se buscan los colores de piedra en botón / pinchos
+void region_piedra(int w, int h, int& x0, int& y0, int& x1, int& y1) {
+    int region_w = w * 0.8;
+    int region_h = h - 15;
+    x0 = (w - region_w) / 2;
+    y0 = (h - region_h) / 2;
+    x1 = x0 + region_w;
+    y1 = y0 + region_h;
 }
 
-double calc_mae(const vector<unsigned char>& cell, const vector<unsigned char>& templ, int x1, int y1, int x0, int y0, int w) {
-    double mae = 0;
-    int cuenta = 0;
-    for (int y = y0; y < y1; ++y)
-        for (int x = x0; x < x1; ++x) {
-            int idx = (y * w + x) * 3;
-            for (int k = 0; k < 3; ++k)
-                mae += abs(int(cell[idx + k]) - int(templ[idx + k]));
-            cuenta++;
-        }
-    return cuenta > 0 ? mae / (cuenta * 3.0) : 1e9;
+// Personaje según el primer píxel en que se cumple alguna condición, en el
+// orden de es_personaje (con botón, con llave, normal)
+static int personaje_en_orden(const uint16_t* m, int n) {
+    uint16_t visto = 0;
+    for (int k = 0; k < n; ++k) {
+        visto |= m[k];
+        bool blanco = visto & COLOR_BLANCO, beige = visto & COLOR_BEIGE;
+        if (blanco && beige && (visto & COLOR_BOTON)) return 19;
+        if (blanco && (visto & COLOR_LLAVE)) return 15;
+        if (blanco && beige) return 4;
+    }
+    return -1;
 }
 
-double chi2_hist(const std::vector<int>& h1, const std::vector<int>& h2) {
-    double chi2 = 0.0;
-    const double eps = 1e-10;
-    for (size_t i = 0; i < h1.size(); ++i) {
-        double num = h1[i] - h2[i];
-        double denom = h1[i] + h2[i] + eps;
-        chi2 += (num * num) / denom;
+// Escaneo de colores exactos que se detiene en el primer diamante o salida
+static void escaneo_en_orden(const uint16_t* m, int n, RasgosCelda& r) {
+    bool gris = false, cafe = false;
+    for (int k = 0; k < n; ++k) {
+        if (m[k] & COLOR_DIAMANTE) {
+            r.diamante = true;
+            return;
+        }
+        if (m[k] & COLOR_PISO) r.piso = true;
+        if (m[k] & COLOR_PARED) r.pared = true;
+        if (m[k] & COLOR_GRIS_SALIDA) gris = true;
+        if (m[k] & COLOR_CAFE_SALIDA) cafe = true;
+        if (cafe && gris) {
+            r.salida = true;
+            return;
+        }
     }
-    return chi2;
 }
 
-vector<unsigned char> extraer_region(const vector<unsigned char>& img, int w, int h, int x0, int y0, int x1, int y1) {
-    vector<unsigned char> region;
-    for (int y = y0; y < y1; ++y) {
-        for (int x = x0; x < x1; ++x) {
-            int idx = (y * w + x) * 3;
-            region.push_back(img[idx]);
-            region.push_back(img[idx + 1]);
-            region.push_back(img[idx + 2]);
+void extraer_rasgos(const VistaImagen& cell, RasgosCelda& r, MemoriaCelda& mem) {
+    int cx0, cy0, cx1, cy1, px0, py0, px1, py1;
+    region_central_bloqueado(cell.ancho, cell.alto, cx0, cy0, cx1, cy1);
+    region_piedra(cell.ancho, cell.alto, px0, py0, px1, py1);
+
+    r.diamante = r.pared = r.piso = r.salida = false;
+    r.hist.fill(0);
+    r.hist_central.fill(0);
+
+    int n = cell.ancho * cell.alto;
+    vector<uint8_t>& bins = mem.bins;
+    vector<uint16_t>& mascaras = mem.mascaras;
+    bins.resize(cell.ancho);
+    mascaras.resize(n);
+
+    // Una pasada: bins del histograma y clases de color de cada píxel
+    uint16_t todas = 0, piedra = 0;
+    int negros = 0, cafes = 0;
+    for (int y = 0; y < cell.alto; ++y) {
+        const unsigned char* p = cell.fila(y);
+        kernels.bins(p, cell.canales, cell.ancho, bins.data());
+        for (int x = 0; x < cell.ancho; ++x) r.hist[bins[x]]++;
+        if (y >= cy0 && y < cy1)
+            for (int x = cx0; x < cx1; ++x) r.hist_central[bins[x]]++;
+
+        uint16_t* m = mascaras.data() + (size_t)y * cell.ancho;
+        for (int x = 0; x < cell.ancho; ++x, p += cell.canales) {
+            uint16_t c = tabla_colores(p[0], p[1], p[2]);
+            m[x] = c;
+            todas |= c;
+            negros += c & COLOR_NEGRO;
+            cafes += (c & COLOR_CAFE) >> 1;
         }
+        if (y >= py0 && y < py1)
+            for (int x = px0; x < px1; ++x) piedra |= m[x];
+    }
+    r.negros = negros;
+    r.cafes = cafes;
+    r.otros = n - negros - cafes;
+    r.piedra_negro = piedra & COLOR_PIEDRA_NEGRO;
+    r.piedra_cafe = piedra & COLOR_BOTON;
+
+    // Si en la celda solo se puede cumplir una condición de personaje, el orden
+    // de los píxeles no importa; si no, se repasa en orden.
+    bool blanco = todas & COLOR_BLANCO, beige = todas & COLOR_BEIGE;
+    bool con_boton = blanco && beige && (todas & COLOR_BOTON);
+    bool con_llave = blanco && (todas & COLOR_LLAVE);
+    bool normal = blanco && beige;
+    int cumplidas = con_boton + con_llave + normal;
+    if (cumplidas == 0) r.personaje = -1;
+    else if (cumplidas == 1) r.personaje = con_llave ? 15 : 4;
+    else r.personaje = personaje_en_orden(mascaras.data(), n);
+
+    // Sin diamante ni salida el escaneo recorre toda la celda
+    bool corta = (todas & COLOR_DIAMANTE) || ((todas & COLOR_GRIS_SALIDA) && (todas & COLOR_CAFE_SALIDA));
+    if (corta) {
+        escaneo_en_orden(mascaras.data(), n, r);
+    } else {
+        r.pared = todas & COLOR_PARED;
+        r.piso = todas & COLOR_PISO;
     }
-    return region;
 }
+// Etiqueta de una celda (fila >= 2) a partir de sus rasgos
+int decidir_etiqueta(const RasgosCelda& r, bool es_bloque_bloqueado, const vector<TileTemplate>& templates,
+                     const IndicePlantillas* indice, MemoriaCelda& mem) {
+    if (r.diamante) {
+        return 2;
+    }
+    if (r.pared) {
+        if (r.piso){
+            return 0;
+        }
+        return 1;
+    }
+    // if (r.salida) {
+    //     return 8;
+    // }
+    int etiqueta = -1;
+    if (r.personaje > 0) {
+        etiqueta = r.personaje;
+        //return etiqueta;
+    }
 
-// Clasificación de celdas
-vector<vector<int>> clasificar_celdas(const unsigned char* img, int width, int height,
-                                    int filas, int columnas, int block_w, int block_h,
-                                    const vector<TileTemplate>& templates) {
-    vector<vector<int>> etiquetas(filas, vector<int>(columnas, -1));
-    unordered_map<int, int> tile_to_tipo = {
-        {3, 1}, {4, 1}, {11, 1}, {12, 1}, {13, 1}, {14, 1}, {15, 1}, {16, 1}, {39, 1},  // pared
-        {7, 0}, {30, 0}, {32, 0}, {38, 0}, {40, 0}, {41, 0}, {42, 0}, {44, 0}, // piso
-        {0, 2},  // diamante
-        {2, 3},  // llave
-        {5, 4},  // personaje
-        {8, 5},  // puerta
-        {6, 6},  // piedra
-        {9, 7}, {25, 7}, {17, 7}, //pinchos
-        {10, 8}, // salida
-        {1, 9}, {43, 9}, // hueco
-        {18, 10}, {19, 10}, {20, 10}, {21, 10}, {22, 10}, {23, 10}, {24, 10},  // lava
-        {26, 11},  // reja
-        {27, 12},  // boton
-        {28, 13},  // estatua
-        {29, 14},  // pinchos - afuera
-        {31, 15},  // personaje con llave
-        {32, 16},  // piedra en hueco
-        {33, 17},  // reja abajo
-        {34, 18},  // piedra en boton
-        {35, 19},  // personaje en boton
-        {36, 20},  // Piedra en pinchos
-        {37, 21},  // Personaje - Boton - Llaves
- 
-    };
+    // Bloque bloqueado: chi2 del histograma normalizado de la región central.
+    // Resto: chi2 del histograma de la celda completa.
+    Histograma64 hist_cell = es_bloque_bloqueado ? r.hist_central : r.hist;
+    if (es_bloque_bloqueado) normalizar_histograma(hist_cell);
+
+    int best_idx = plantilla_mas_cercana(hist_cell, es_bloque_bloqueado, templates, indice, mem);
+    etiqueta = best_idx >= 0 ? templates[best_idx].tipo : -1;
+
+    // Si la etiqueta es piedra (6, 18, 20), decide por los colores de la región de piedra
+    if (etiqueta == 6 || etiqueta == 18 || etiqueta == 20) {
+        if (r.piedra_cafe && r.piedra_negro) {
+            etiqueta = 18; // Piedra en botón
+        } else if (r.piedra_negro) {
+            etiqueta = 20; // Piedra en pinchos
+        } else {
+            etiqueta = 6; // Piedra normal
+        }
+    }
 
-    // --- Fase 1: Detectar bloque de encima del personaje
-    vector<vector<bool>> bloque_bloqueado(filas, vector<bool>(columnas, false));
-    for (int i = filas - 1; i >= 0; --i) {
-        for (int j = 0; j < columnas; ++j) {
-            vector<unsigned char> cell = extraer_celda(img, width, height, block_w, block_h, i, j);
-            if (es_personaje(cell) && i > 0) {
-                bloque_bloqueado[i-1][j] = true;
+    // Si la etiqueta es personaje (4, 19), compara solo con plantillas 5, 35
+    if (etiqueta == 4 || etiqueta == 19) {
+        // Compara con las plantillas 5 y 35 (ajusta si tus índices son otros)
+        int idx_5 = 5, idx_35 = 35;
+        int diff_5 = abs(r.negros - templates[idx_5].negros);
+        int diff_35 = abs(r.negros - templates[idx_35].negros);
+
+        // Asigna la etiqueta según la plantilla más cercana en cantidad de negros
+        if (diff_5 < diff_35)
+            etiqueta = 4; // Personaje normal
+        else
+            etiqueta = 19; // Personaje en botón
+    }
+
+    if (etiqueta == 14 || etiqueta == 17) {
+        static const int candidatos[] = {29, 33};
+        double min_diff = std::numeric_limits<double>::max();
+        int mejor_etiqueta = etiqueta;
+
+        // Histograma normalizado de la celda completa
+        Histograma64 hist_norm = r.hist;
+        normalizar_histograma(hist_norm);
+
+        for (int cand : candidatos) {
+            if (cand < 0 || cand >= (int)templates.size()) continue;
+            double diff = chi2_hist(hist_norm, templates[cand].hist_rgb_norm);
+            if (diff < min_diff) {
+                min_diff = diff;
+                mejor_etiqueta = templates[cand].tipo;
             }
         }
+        etiqueta = mejor_etiqueta;
     }
+    return etiqueta;
+}
+
+// Bloque de encima del personaje. es_personaje devuelve -1 cuando no hay
+// personaje, que también cuenta como verdadero, así que toda celda con otra
+// debajo queda bloqueada: depende de la geometría, no del contenido.
+inline bool celda_bloqueada(int i, int filas) {
+    return i + 1 < filas;
+}
+
+// Clasifica la celda (i, j) de una fila >= 2. 'hash' es hash_celda de la
+// celda y solo se usa si hay caché.
+int clasificar_celda(const Fotograma& fotograma, int i, int j, int filas, int block_w, int block_h,
+                     const vector<TileTemplate>& templates, const IndicePlantillas* indice,
+                     CacheCeldas* cache, uint64_t hash, MemoriaCelda& mem) {
+    bool es_bloque_bloqueado = celda_bloqueada(i, filas);
+    int etiqueta;
+    if (cache && cache->buscar(hash, es_bloque_bloqueado, etiqueta)) return etiqueta;
+
+    RasgosCelda r;
+    extraer_rasgos(vista_celda(fotograma, block_w, block_h, i, j), r, mem);
+    etiqueta = decidir_etiqueta(r, es_bloque_bloqueado, templates, indice, mem);
+    if (cache) cache->insertar(hash, es_bloque_bloqueado, etiqueta);
+    return etiqueta;
+}
+
+vector<vector<int>> clasificar_celdas(const Fotograma& fotograma,
+                                    int filas, int columnas, int block_w, int block_h,
+                                    const vector<TileTemplate>& templates,
+                                    CacheCeldas* cache, const IndicePlantillas* indice) {
+    // Las dos primeras filas siempre son pared
+    vector<vector<int>> etiquetas(filas, vector<int>(columnas, 1));
 
-    // --- Fase 2: Clasificación paralelizada ---
     #pragma omp parallel for collapse(2) schedule(dynamic)
-    for (int i = 0; i < filas; ++i) {
+    for (int i = 2; i < filas; ++i) {
         for (int j = 0; j < columnas; ++j) {
+            static thread_local MemoriaCelda mem;
+            uint64_t hash = cache ? hash_celda(fotograma, block_w, block_h, i, j) : 0;
+            etiquetas[i][j] = clasificar_celda(fotograma, i, j, filas, block_w, block_h, templates, indice, cache, hash, mem);
+        }
+    }
+    return etiquetas;
+}
 
-            // Las dos primeras filas siempre son pared
-            if (i < 2) {
-                etiquetas[i][j] = 1;
-                continue;
-            }
+// Huella de las plantillas y de la lógica de decisión, para no reutilizar una
+// caché de celdas calculada con otras
+uint64_t huella_plantillas(const vector<TileTemplate>& templates) {
+    const uint32_t VERSION_CLASIFICADOR = 1;
+    Hash64 h;
+    h.actualizar(&VERSION_CLASIFICADOR, sizeof(VERSION_CLASIFICADOR));
+    for (const TileTemplate& t : templates) {
+        int cabecera[6] = {t.w, t.h, t.c, t.negros, t.tipo, (int)t.name.size()};
+        h.actualizar(cabecera, sizeof(cabecera));
+        h.actualizar(t.name.data(), t.name.size());
+        if (t.data) h.actualizar(t.data, (size_t)t.w * t.h * 3);
+    }
+    return h.final();
+}
 
-            vector<unsigned char> cell = extraer_celda(img, width, height, block_w, block_h, i, j);
-
-            
-            bool tiene_color_diamante = false;
-            bool tiene_color_llave = false;
-            bool tiene_color_pared = false;
-            bool tiene_color_salida = false;
-            bool tiene_gris = false;
-            bool tiene_cafe = false;
-            bool color_piso = false;
-            for (size_t idx = 0; idx < cell.size(); idx += 3) {
-                unsigned char r = cell[idx], g = cell[idx+1], b = cell[idx+2];
-
-                if ((r == 67 || r == 66) && (g == 76 || g == 78) && (b  == 63 || b == 64)) {
-                    tiene_color_diamante = true;
-                    break;
-                }
-                // if (r == 57 && g == 237 && b == 218) {
-                //     tiene_color_llave = true;
-                //     break;
-                // }
-                if ((r == 63 && g == 40 && b == 28)) {
-                    color_piso = true;
-                }
-                if (r == 38 && g == 38 && b == 38) {
-                    tiene_color_pared = true;
-                }
-                if ((r <= 162 && r >= 155) && (g >= 150 && g <= 160) && (b >= 150 && b <= 160)) {
-                    tiene_gris = true;
-                }
-                else if (((r >= 95 && r <=  106) && (g >= 45 && g <= 55) && (b >= 15 && b <= 24))){
-                    tiene_cafe = true;
-                }
-                if (tiene_cafe && tiene_gris) {
-                    tiene_color_salida = true;
-                    break;
-                }
-            }
+TileClassifier::TileClassifier(vector<TileTemplate> plantillas, int filas, int columnas, int hilos)
+    : templates(move(plantillas)), indice(make_unique<IndicePlantillas>(templates)),
+      cache_celdas(huella_plantillas(templates)), filas(filas), columnas(columnas),
+      pool(hilos > 0 ? hilos : max(1u, thread::hardware_concurrency())),
+      memoria(pool.tamano()) {}
 
-            if (tiene_color_diamante) {
-                etiquetas[i][j] = 2;
-                continue;
-            }
-            // if (tiene_color_llave) {
-            //     etiquetas[i][j] = 3;
-            //     continue;
-            // }
-            if (tiene_color_pared) {
-                if (color_piso){
-                    etiquetas[i][j] = 0;
-                    continue;
-                }
-                etiquetas[i][j] = 1;
-                continue;
-            }
-            // if (tiene_color_salida) {
-            //     etiquetas[i][j] = 8;
-            //     continue;
-            // }
-            int personaje = es_personaje(cell);
-            if (personaje > 0) {
-                etiquetas[i][j] = personaje;
-                //continue;
-            }
+TileClassifier::~TileClassifier() = default;
 
-            // --- Aquí usa bloque_bloqueado[i][j] ---
-            bool es_bloque_bloqueado = bloque_bloqueado[i][j];
-            
-            const double REGION_CENTRAL = 1; // 50% del tamaño original
-
-            double min_diff = numeric_limits<double>::max();
-            int best_idx = -1;
-            for (size_t t = 0; t < templates.size(); ++t) {
-                int w = templates[t].w, h = templates[t].h;
-                // Región central
-                int region_w = int(w * REGION_CENTRAL);  // 50% del ancho
-                int region_h = int(h * REGION_CENTRAL);  // 50% de la altura
-                int x0 = (w - region_w) / 4;  // Centrado en X
-                int y0 = (h - region_h) / 4;  // Centrado en Y
-                int x1 = x0 + region_w;
-                int y1 = y0 + region_h;
-
-                double diff = 0;
-                if (es_bloque_bloqueado) {
-                    double mae = calc_mae(cell, templates[t].data, w, h, 0, 0, w);
-
-                    // Región central del 50%
-                    int region_w = w * 0.6;
-                    int region_h = h * 0.3;
-                    int x0_c = (w - region_w) / 2;
-                    int y0_c = (h - region_h) / 2;
-                    int x1_c = x0_c + region_w;
-                    int y1_c = y0_c + region_h;
-
-                    double diff_central = calc_mae(cell, templates[t].data, x1_c, y1_c, x0_c, y0_c, w);
-
-                    int n1, c1, b1, o1, n2, c2, b2, o2;
-                    histograma(cell, n1, c1, b1, o1);
-                    histograma(templates[t].data, n2, c2, b2, o2);
-                    double diff_hist_simple = abs(n1-n2) + abs(c1-c2) + abs(b1-b2) + abs(o1-o2);
-
-                    // Histograma de la región central del 50%
-                    vector<unsigned char> region_cell = extraer_region(cell, w, h, x0_c, y0_c, x1_c, y1_c);
-                    vector<unsigned char> region_template = extraer_region(templates[t].data, w, h, x0_c, y0_c, x1_c, y1_c);
-
-                    vector<int> hist_cell_full = calcular_histograma_rgb(region_cell, 4);
-                    vector<int> hist_template_full = calcular_histograma_rgb(region_template, 4);
-                    normalizar_histograma(hist_cell_full);
-                    normalizar_histograma(hist_template_full);
-                    double diff_hist = chi2_hist(hist_cell_full, hist_template_full);
-
-                    double peso_hist = 1;
-                    double peso_mae = 1.0;
-                    double peso_central = 1.0;
-                    diff = peso_hist * diff_hist;
-
-                } else {
-                    // --- Región central: histograma + chi2 ---
-                    vector<unsigned char> region_cell = extraer_region(cell, w, h, x0, y0, x1, y1);
-                    vector<unsigned char> region_template = extraer_region(templates[t].data, w, h, x0, y0, x1, y1);
-
-                    vector<int> hist_central_cell = calcular_histograma_rgb(region_cell, 4);
-                    vector<int> hist_central_template = calcular_histograma_rgb(region_template, 4);
-                            
-                    //normalizar_histograma(hist_central_cell);
-                    //normalizar_histograma(hist_central_template);
-                    double diff_central = chi2_hist(hist_central_cell, hist_central_template);
-
-                    double peso_hist = 0;
-                    double peso_central = 1;
-                    diff = peso_central * diff_central;
-                    //diff = peso_hist * diff_hist;
-                }
-                if (diff < min_diff) {
-                    min_diff = diff;
-                    best_idx = t;
-                }
-            }
-            etiquetas[i][j] = tile_to_tipo.count(best_idx) ? tile_to_tipo[best_idx] : best_idx;
-
-            // Si la etiqueta es piedra (6, 18, 20), compara solo con plantillas 6, 34, 36
-            if (etiquetas[i][j] == 6 || etiquetas[i][j] == 18 || etiquetas[i][j] == 20) {
-                // Extraer región central del 50%
-                int region_w = block_w * 0.8;
-                int region_h = block_h - 15;
-                int x0 = (block_w - region_w) / 2;
-                int y0 = (block_h - region_h) / 2;
-                int x1 = x0 + region_w;
-                int y1 = y0 + region_h;
-                vector<unsigned char> region_central = extraer_region(cell, block_w, block_h, x0, y0, x1, y1);
-
-                bool hay_negro = false, hay_cafe = false;
-                for (size_t idx = 0; idx < region_central.size(); idx += 3) {
-                    unsigned char r = region_central[idx], g = region_central[idx+1], b = region_central[idx+2];
-                    if (r == 16 && g == 9 && b == 5)
-                        hay_negro = true;
-                    else if (r == 117 && g == 80 && b == 61)
-                        hay_cafe = true;
-                }
-                if (hay_cafe && hay_negro) {
-                    etiquetas[i][j] = 18; // Piedra en botón
-                } else if (hay_negro) {
-                    etiquetas[i][j] = 20; // Piedra en pinchos
-                } else {
-                    etiquetas[i][j] = 6; // Piedra normal
-                }
-            }
-
-            // Si la etiqueta es personaje (4, 19), compara solo con plantillas 5, 35
-            if (etiquetas[i][j] == 4 || etiquetas[i][j] == 19) {
-                // Extraer región central del 50%
-                int region_w = block_w;
-                int region_h = block_h;
-                int x0 = (block_w - region_w) / 2;
-                int y0 = (block_h - region_h) / 2;
-                int x1 = x0 + region_w;
-                int y1 = y0 + region_h;
-                vector<unsigned char> region_central = extraer_region(cell, block_w, block_h, x0, y0, x1, y1);
-
-                // Cuenta la cantidad de negros en la celda
-                int negros_celda = 0;
-                for (size_t idx = 0; idx < cell.size(); idx += 3) {
-                    unsigned char r = cell[idx], g = cell[idx+1], b = cell[idx+2];
-                    if (r < 40 && g < 40 && b < 40)
-                        negros_celda++;
-                }
+const vector<vector<int>>& TileClassifier::classify(const Fotograma& fotograma) {
+    preparar(fotograma);
+    procesar(fotograma, nullptr, true);
+    return etiquetas;
+}
 
-                // Compara con las plantillas 5 y 35 (ajusta si tus índices son otros)
-                int idx_5 = 5, idx_35 = 35;
-                int negros_5 = templates[idx_5].negros;
-                int negros_35 = templates[idx_35].negros;
+const vector<vector<int>>& TileClassifier::classify_incremental(const Fotograma& fotograma,
+                                                                const vector<bool>* celdas_tocadas) {
+    bool completo = preparar(fotograma);
+    procesar(fotograma, completo ? nullptr : celdas_tocadas, completo);
+    return etiquetas;
+}
 
-                int diff_5 = abs(negros_celda - negros_5);
-                int diff_35 = abs(negros_celda - negros_35);
+vector<vector<vector<int>>> TileClassifier::classify_batch(const vector<Fotograma>& fotogramas) {
+    // Las dos primeras filas siempre son pared
+    vector<vector<vector<int>>> resultado(fotogramas.size(), vector<vector<int>>(filas, vector<int>(columnas, 1)));
+    vector<pair<int, int>> bloques(fotogramas.size()); // block_w, block_h de cada fotograma
+    for (size_t f = 0; f < fotogramas.size(); ++f)
+        bloques[f] = {(int)round((float)fotogramas[f].ancho / columnas), (int)round((float)fotogramas[f].alto / filas)};
+
+    int por_fotograma = (filas - 2) * columnas;
+    n_reclasificadas.store(0, memory_order_relaxed);
+    pool.ejecutar((int)fotogramas.size() * por_fotograma, [&](int tarea, int hilo) {
+        int f = tarea / por_fotograma, c = tarea % por_fotograma;
+        int i = 2 + c / columnas, j = c % columnas;
+        const Fotograma& fotograma = fotogramas[f];
+        auto [bw, bh] = bloques[f];
+        uint64_t hash = con_cache ? hash_celda(fotograma, bw, bh, i, j) : 0;
+        resultado[f][i][j] = clasificar_celda(fotograma, i, j, filas, bw, bh, templates, indice.get(),
+                                              con_cache ? &cache_celdas : nullptr, hash, memoria[hilo]);
+    });
+    n_reclasificadas.store((int)fotogramas.size() * por_fotograma, memory_order_relaxed);
+    return resultado;
+}
 
-                // Asigna la etiqueta según la plantilla más cercana en cantidad de negros
-                if (diff_5 < diff_35)
-                    etiquetas[i][j] = 4; // Personaje normal
-                else
-                    etiquetas[i][j] = 19; // Personaje en botón
-            }
+bool TileClassifier::preparar(const Fotograma& fotograma) {
+    if (fotograma.ancho == ancho && fotograma.alto == alto && !etiquetas.empty()) return false;
+    ancho = fotograma.ancho;
+    alto = fotograma.alto;
+    block_h = round((float)alto / filas);
+    block_w = round((float)ancho / columnas);
+    // Las dos primeras filas siempre son pared
+    etiquetas.assign(filas, vector<int>(columnas, 1));
+    hashes.assign((size_t)filas * columnas, 0);
+    return true;
+}
 
-            if (etiquetas[i][j] == 14 || etiquetas[i][j] == 17) {
-                vector<int> candidatos = {29, 33};
-                double min_diff = std::numeric_limits<double>::max();
-                int mejor_etiqueta = etiquetas[i][j];
-
-                for (int cand : candidatos) {
-                    if (cand < 0 || cand >= (int)templates.size()) continue;
-                    int w = block_w, h = block_h;
-                    int region_w = w;
-                    int region_h = h;
-                    int x0 = (w - region_w) / 2;
-                    int y0 = (h - region_h) / 2;
-                    int x1 = x0 + region_w;
-                    int y1 = y0 + region_h;
-
-                    // Extrae la región central del 80% del bloque y la plantilla
-                    vector<unsigned char> region_cell = extraer_region(cell, w, h, x0, y0, x1, y1);
-                    vector<unsigned char> region_template = extraer_region(templates[cand].data, w, h, x0, y0, x1, y1);
-
-                    vector<int> hist_cell = calcular_histograma_rgb(region_cell, 4);
-                    vector<int> hist_template = calcular_histograma_rgb(region_template, 4);
-                    normalizar_histograma(hist_cell);
-                    normalizar_histograma(hist_template);
-                    double diff = chi2_hist(hist_cell, hist_template);
-                    if (diff < min_diff) {
-                        min_diff = diff;
-                        mejor_etiqueta = tile_to_tipo.count(cand) ? tile_to_tipo[cand] : cand;
-                    }
-                }
-                etiquetas[i][j] = mejor_etiqueta;
-            }
-        }
-    }
-    return etiquetas;
+void TileClassifier::procesar(const Fotograma& fotograma, const vector<bool>* celdas_tocadas, bool todas) {
+    n_reclasificadas.store(0, memory_order_relaxed);
+    int n = (filas - 2) * columnas;
+    pool.ejecutar(n, [&](int tarea, int hilo) {
+        int i = 2 + tarea / columnas, j = tarea % columnas;
+        size_t k = (size_t)i * columnas + j;
+        if (!todas && celdas_tocadas && k < celdas_tocadas->size() && !(*celdas_tocadas)[k]) return;
+        // Sin caché, al reclasificar todo el hash solo le serviría a la
+        // siguiente classify_incremental; con 0 esa reclasifica la celda
+        uint64_t hash = con_cache || !todas ? hash_celda(fotograma, block_w, block_h, i, j) : 0;
+        if (!todas && hash == hashes[k]) return;
+        hashes[k] = hash;
+        etiquetas[i][j] = clasificar_celda(fotograma, i, j, filas, block_w, block_h, templates, indice.get(),
+                                           con_cache ? &cache_celdas : nullptr, hash, memoria[hilo]);
+        n_reclasificadas.fetch_add(1, memory_order_relaxed);
+    });
 }
 
 // Función para leer todas las matrices del archivo
@@ -530,100 +749,3 @@ void guardar_matriz_txt(const vector<vector<int>>& etiquetas, const string& file
     }
     fout.close();
 }
-
-
-int main() {
-
-    using namespace chrono;
-    auto start = high_resolution_clock::now(); // Marca el inicio
-
-    tomar_captura();
-
-
-    int width, height, channels;
-    int filas = 15;
-    int columnas = 10;
-    int cant_tiles = 45;
-    int cont_matri_confl = 0;
-
-    unsigned char* img = cargar_imagen("captura_firefox.png", width, height, channels);
-
-    if (!img) {
-        cerr << "No se pudo cargar " << img << endl;
-        return 1;
-    }
-
-    int block_h = round((float)height / filas);
-    int block_w = round((float)width / columnas);
-    
-    vector<TileTemplate> templates = cargar_plantillas_preprocesadas("plantillas_preprocesadas.txt", cant_tiles);
-    vector<vector<int>> etiquetas = clasificar_celdas(img, width, height, filas, columnas, block_w, block_h, templates);
-    guardar_matriz_txt(etiquetas, "matriz_clasificacion.txt");
-    system("python3 solver.py");
-
-
-    //imprimir_matriz(etiquetas);
-    stbi_image_free(img);
-
-    
-
-    // Leer matrices de referencia
-    // vector<vector<vector<int>>> matrices_ref = leer_matrices_archivo("extras/niveles.txt", filas, columnas);
-
-    // int idx_ref = 0;
-    // for (int nivel = 2; nivel <= 20; ++nivel, ++idx_ref) {
-    //     string fname = "niveles/nivel" + to_string(nivel) + ".png";
-    //     unsigned char* img = cargar_imagen(fname, width, height, channels);
-    //     if (!img) {
-    //         cerr << "No se pudo cargar " << fname << endl;
-    //         continue;
-    //     }
-
-    //     int block_h = round((float)height / filas);
-    //     int block_w = round((float)width / columnas);
-
-    //     vector<TileTemplate> templates = cargar_plantillas_preprocesadas("plantillas_preprocesadas.txt", cant_tiles);
-    //     vector<vector<int>> etiquetas = clasificar_celdas(img, width, height, filas, columnas, block_w, block_h, templates);
-
-    //     // Comparar con la matriz de referencia
-    //     if (idx_ref >= matrices_ref.size() || !matrices_iguales(etiquetas, matrices_ref[idx_ref])) {
-    //         cont_matri_confl++;
-    //         cout << "Diferencia en nivel " << nivel << ":\n";
-    //         cout << "Generada:\n";
-    //         imprimir_matriz(etiquetas);
-    //         cout << "Referencia:\n";
-    //         if (idx_ref < matrices_ref.size())
-    //             imprimir_matriz(matrices_ref[idx_ref]);
-    //         else
-    //             cout << "(No hay matriz de referencia)\n";
-
-    //         // Mostrar cantidad y posiciones de casillas diferentes
-    //         int diferencias = 0;
-    //         if (idx_ref < matrices_ref.size()) {
-    //             for (int i = 0; i < filas; ++i) {
-    //                 for (int j = 0; j < columnas; ++j) {
-    //                     if (etiquetas[i][j] != matrices_ref[idx_ref][i][j]) {
-    //                         diferencias++;
-    //                         cout << "Diferencia en (" << i << ", " << j << "): "
-    //                              << "Generada=" << etiquetas[i][j]
-    //                              << ", Referencia=" << matrices_ref[idx_ref][i][j] << endl;
-
-    //                     }
-    //                 }
-    //             }
-    //         }
-    //         cout << "Cantidad de casillas diferentes: " << diferencias << endl;
-    //         cout << endl;
-    //     }
-
-    //     stbi_image_free(img);
-    // }
-
-    // cout << "Total de matrices con conflicto: " << cont_matri_confl << endl;
-
-    auto end = high_resolution_clock::now(); // Marca el final
-    auto duration = duration_cast<milliseconds>(end - start);
-    cout << "Tiempo de ejecución Total Programa: " << duration.count() << " ms" << endl;
-
-    return 0;
-}
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CLASIFICADOR_X86 1
+#endif
+
+#include "rasgos.h"
+
+using namespace std;
+
+bool es_color_cafe(unsigned char r, unsigned char g, unsigned char b) {
+    return (r >= 40 && r <= 90) && (g >= 25 && g <= 65) && (b >= 20 && b <= 50);
+}
+
+void histograma(const VistaImagen& img, int& negros, int& cafes, int& blancos, int& otros) {
+    negros = cafes = blancos = otros = 0;
+    for (int y = 0; y < img.alto; ++y) {
+        const unsigned char* p = img.fila(y);
+        for (int x = 0; x < img.ancho; ++x, p += img.canales) {
+            unsigned char r = p[0], g = p[1], b = p[2];
+            if (r < 40 && g < 40 && b < 40)
+                negros++;
+            else if (es_color_cafe(r, g, b))
+                cafes++;
+            else
+                otros++;
+        }
+    }
+}
+
+// --- Kernels vectoriales del emparejamiento de plantillas ---
+
+// Índice de bin RGB (4 niveles por canal) de 'n' píxeles consecutivos
+static void bins_fila_escalar(const unsigned char* p, int canales, int n, uint8_t* bins) {
+    for (int x = 0; x < n; ++x, p += canales)
+        bins[x] = (p[0] >> 6) * 16 + (p[1] >> 6) * 4 + (p[2] >> 6);
+}
+
+// Los chi2 dejan de sumar en cuanto la suma parcial pasa de 'limite': todos
+// los términos son positivos, así que el total tampoco bajaría de ahí. Si no
+// se corta, el resultado es el mismo que sin límite.
+//
+// La suma va en 4 parciales (término i en el parcial i % 4) que se juntan como
+// (p0 + p2) + (p1 + p3), el mismo orden que los 4 carriles de chi2_avx2: así
+// los dos dan el mismo double, bit a bit, y un casi empate entre plantillas
+// se resuelve igual en cualquier CPU.
+static double chi2_escalar(const int* h1, const int* h2, double limite) {
+    const double eps = 1e-10;
+    double parcial[4] = {0.0, 0.0, 0.0, 0.0};
+    double chi2 = 0.0;
+    for (int i = 0; i < 64; ++i) {
+        double num = h1[i] - h2[i];
+        double denom = h1[i] + h2[i] + eps;
+        parcial[i & 3] += (num * num) / denom;
+        if ((i & 15) == 15) {
+            chi2 = (parcial[0] + parcial[2]) + (parcial[1] + parcial[3]);
+            if (chi2 > limite) break;
+        }
+    }
+    return chi2;
+}
+
+#ifdef CLASIFICADOR_X86
+// Con los píxeles como dwords R,G,B,x: bin = (R >> 6) << 4 | (G >> 6) << 2 | B >> 6
+__attribute__((target("sse4.1")))
+static inline __m128i bins_rgbx_sse41(__m128i v) {
+    __m128i r = _mm_and_si128(_mm_srli_epi32(v, 2), _mm_set1_epi32(0x30));
+    __m128i g = _mm_and_si128(_mm_srli_epi32(v, 12), _mm_set1_epi32(0x0c));
+    __m128i b = _mm_and_si128(_mm_srli_epi32(v, 22), _mm_set1_epi32(0x03));
+    return _mm_or_si128(_mm_or_si128(r, g), b);
+}
+
+__attribute__((target("sse4.1")))
+static void bins_fila_sse41(const unsigned char* p, int canales, int n, uint8_t* bins) {
+    const __m128i rgb_a_rgbx = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i bytes_bajos = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    int x = 0;
+    if (canales == 4) {
+        for (; x + 4 <= n; x += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(p + 4 * x));
+            int32_t cuatro = _mm_cvtsi128_si32(_mm_shuffle_epi8(bins_rgbx_sse41(v), bytes_bajos));
+            memcpy(bins + x, &cuatro, 4);
+        }
+    } else {
+        // La carga de 16 bytes usa 12; no se lee más allá del último píxel
+        for (; x + 6 <= n; x += 4) {
+            __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 3 * x)), rgb_a_rgbx);
+            int32_t cuatro = _mm_cvtsi128_si32(_mm_shuffle_epi8(bins_rgbx_sse41(v), bytes_bajos));
+            memcpy(bins + x, &cuatro, 4);
+        }
+    }
+    bins_fila_escalar(p + canales * x, canales, n - x, bins + x);
+}
+
+__attribute__((target("avx2")))
+static void bins_fila_avx2(const unsigned char* p, int canales, int n, uint8_t* bins) {
+    const __m256i rgb_a_rgbx = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                                0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i bytes_bajos = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                 0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    int x = 0;
+    for (;;) {
+        __m256i v;
+        if (canales == 4) {
+            if (x + 8 > n) break;
+            v = _mm256_loadu_si256((const __m256i*)(p + 4 * x));
+        } else {
+            if (x + 10 > n) break; // la segunda carga llega hasta el byte 3 * x + 28
+            __m128i lo = _mm_loadu_si128((const __m128i*)(p + 3 * x));
+            __m128i hi = _mm_loadu_si128((const __m128i*)(p + 3 * x + 12));
+            v = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), rgb_a_rgbx);
+        }
+        __m256i r = _mm256_and_si256(_mm256_srli_epi32(v, 2), _mm256_set1_epi32(0x30));
+        __m256i g = _mm256_and_si256(_mm256_srli_epi32(v, 12), _mm256_set1_epi32(0x0c));
+        __m256i b = _mm256_and_si256(_mm256_srli_epi32(v, 22), _mm256_set1_epi32(0x03));
+        __m256i bin = _mm256_shuffle_epi8(_mm256_or_si256(_mm256_or_si256(r, g), b), bytes_bajos);
+        int32_t bajo = _mm256_cvtsi256_si32(bin);
+        int32_t alto = _mm_cvtsi128_si32(_mm256_extracti128_si256(bin, 1));
+        memcpy(bins + x, &bajo, 4);
+        memcpy(bins + x + 4, &alto, 4);
+        x += 8;
+    }
+    bins_fila_sse41(p + canales * x, canales, n - x, bins + x);
+}
+
+// Mismos términos y mismo orden de suma que chi2_escalar
+__attribute__((target("avx2")))
+static double chi2_avx2(const int* h1, const int* h2, double limite) {
+    const __m256d eps = _mm256_set1_pd(1e-10);
+    __m256d acc = _mm256_setzero_pd();
+    double suma = 0.0;
+    for (int i = 0; i < 64; i += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(h1 + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(h2 + i));
+        __m256d num = _mm256_cvtepi32_pd(_mm_sub_epi32(a, b));
+        __m256d denom = _mm256_add_pd(_mm256_cvtepi32_pd(_mm_add_epi32(a, b)), eps);
+        acc = _mm256_add_pd(acc, _mm256_div_pd(_mm256_mul_pd(num, num), denom));
+        if ((i & 15) == 12) {
+            __m128d s = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+            suma = _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+            if (suma > limite) break;
+        }
+    }
+    return suma;
+}
+#endif
+
+static KernelsPlantillas elegir_kernels_plantillas() {
+    KernelsPlantillas k = {bins_fila_escalar, chi2_escalar};
+#ifdef CLASIFICADOR_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        k.bins = bins_fila_avx2;
+        k.chi2 = chi2_avx2;
+    } else if (__builtin_cpu_supports("sse4.1")) {
+        k.bins = bins_fila_sse41;
+    }
+#endif
+    return k;
+}
+
+const KernelsPlantillas kernels = elegir_kernels_plantillas();
+
+void calcular_histograma_rgb(const VistaImagen& img, Histograma64& hist) {
+    hist.fill(0);
+    uint8_t bins[1024];
+    for (int y = 0; y < img.alto; ++y) {
+        const unsigned char* p = img.fila(y);
+        for (int x0 = 0; x0 < img.ancho; x0 += 1024) {
+            int n = min(1024, img.ancho - x0);
+            kernels.bins(p + (size_t)x0 * img.canales, img.canales, n, bins);
+            for (int x = 0; x < n; ++x) hist[bins[x]]++;
+        }
+    }
+}
+
+double chi2_hist(const Histograma64& h1, const Histograma64& h2, double limite) {
+    return kernels.chi2(h1.data(), h2.data(), limite);
+}
+
+void engrosar_histograma(const Histograma64& hist, Histograma8& grueso) {
+    grueso.fill(0);
+    for (int k = 0; k < 64; ++k)
+        grueso[((k >> 5) & 1) * 4 + ((k >> 3) & 1) * 2 + ((k >> 1) & 1)] += hist[k];
+}
+
+double chi2_grueso(const Histograma8& h1, const Histograma8& h2) {
+    double chi2 = 0.0;
+    for (int i = 0; i < 8; ++i) {
+        double num = h1[i] - h2[i];
+        double denom = h1[i] + h2[i] + 1e-10;
+        chi2 += (num * num) / denom;
+    }
+    return chi2;
+}
+
+void normalizar_histograma(Histograma64& hist) {
+    int total = 0;
+    for (int v : hist) total += v;
+    if (total == 0) return;
+    for (int& v : hist) v = double(v) / total * 1000; // Escala para mantener precisión entera
+}
+
+void region_central_bloqueado(int w, int h, int& x0, int& y0, int& x1, int& y1) {
+    int region_w = w * 0.6;
+    int region_h = h * 0.3;
+    x0 = (w - region_w) / 2;
+    y0 = (h - region_h) / 2;
+    x1 = x0 + region_w;
+    y1 = y0 + region_h;
+}
+
+void histograma_central_norm(const VistaImagen& img, Histograma64& hist) {
+    int x0, y0, x1, y1;
+    region_central_bloqueado(img.ancho, img.alto, x0, y0, x1, y1);
+    calcular_histograma_rgb(img.region(x0, y0, x1, y1), hist);
+    normalizar_histograma(hist);
+}
@@ -0,0 +1,70 @@
+#ifndef RASGOS_H
+#define RASGOS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <limits>
+
+// Rasgos de imagen comunes al clasificador y a prepro: vistas sobre píxeles,
+// histogramas y los kernels vectoriales con los que se comparan. Las dos
+// herramientas calculan los histogramas de las plantillas con este mismo
+// código, así que los guardados en el pack coinciden con los de las celdas.
+
+// Vista no propietaria sobre píxeles con stride (RGB o RGBA). Las celdas y
+// regiones se recorren en su sitio, sin copiarlas a vectores.
+struct VistaImagen {
+    const unsigned char* datos;
+    int ancho, alto;
+    int stride;  // bytes por fila
+    int canales;
+
+    const unsigned char* fila(int y) const { return datos + (size_t)y * stride; }
+    VistaImagen region(int x0, int y0, int x1, int y1) const {
+        return {datos + (size_t)y0 * stride + (size_t)x0 * canales, x1 - x0, y1 - y0, stride, canales};
+    }
+};
+
+typedef std::array<int, 64> Histograma64;
+
+// Histograma grueso de 8 bins (1 bit por canal). Juntar bins nunca sube el
+// chi2, así que el chi2 grueso es una cota inferior barata del de 64 bins.
+typedef std::array<int, 8> Histograma8;
+
+// --- Kernels vectoriales del emparejamiento de plantillas ---
+// Se elige la variante una vez, según la CPU: con AVX2 los bins y el chi2 son
+// vectoriales; con SSE4.1, solo los bins; si no, todo es escalar.
+typedef void (*KernelBins)(const unsigned char*, int, int, uint8_t*);
+typedef double (*KernelChi2)(const int*, const int*, double);
+
+struct KernelsPlantillas {
+    KernelBins bins;  // índice de bin RGB de 'n' píxeles consecutivos
+    KernelChi2 chi2;  // chi2 de 64 bins, cortado al pasar de 'limite'
+};
+
+extern const KernelsPlantillas kernels;
+
+// Devuelve true si el color está dentro del rango de café
+bool es_color_cafe(unsigned char r, unsigned char g, unsigned char b);
+
+// Histograma de 4 clases (negro, café, blanco, otros)
+void histograma(const VistaImagen& img, int& negros, int& cafes, int& blancos, int& otros);
+
+// Histograma RGB de 4 bins por canal (64 en total)
+void calcular_histograma_rgb(const VistaImagen& img, Histograma64& hist);
+
+double chi2_hist(const Histograma64& h1, const Histograma64& h2,
+                 double limite = std::numeric_limits<double>::infinity());
+
+void engrosar_histograma(const Histograma64& hist, Histograma8& grueso);
+double chi2_grueso(const Histograma8& h1, const Histograma8& h2);
+
+void normalizar_histograma(Histograma64& hist);
+
+// Región central de 60% x 30% con la que se comparan los bloques bloqueados
+void region_central_bloqueado(int w, int h, int& x0, int& y0, int& x1, int& y1);
+
+// Histograma normalizado de la región central
+void histograma_central_norm(const VistaImagen& img, Histograma64& hist);
+
+#endif
@@ -1,15 +1,34 @@
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/Xatom.h>
+#include <X11/extensions/XShm.h>
+#ifdef USE_XDAMAGE
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xfixes.h>
+#endif
+#include <sys/ipc.h>
+#include <sys/shm.h>
 #include <cstdint>
 #include <cstring>
 #include <vector>
 #include <iostream>
 #include <string>
 #include <chrono> // Agrega esto al inicio
+#include <cmath>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CAPTURA_X86 1
+#endif
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
+#include "stb_image.h"
+#include "captura.h"
+#ifdef PLANTILLAS_EMBEBIDAS
+#include "plantillas_embebidas.h"
+#endif
 
 using namespace std;
 
@@ -41,15 +60,250 @@ Window FindWindowByName(Display* display, Window root, const string& name) {
     return result;
 }
 
-void ImageFromWindowRegion(
-    vector<uint8_t>& Pixels,
-    int& Width, int& Height, int& BitsPerPixel,
-    Window win, Display* display,
+// ---- Conversión XImage -> RGBA ----
+// El formato del XImage se analiza una vez por captura y cada fila se convierte
+// con un kernel especializado en lugar de llamar a XGetPixel por píxel.
+
+struct CanalX {
+    int shift = 0;  // posición del bit menos significativo de la máscara
+    int bits = 0;   // ancho de la máscara
+    uint32_t mask = 0;
+};
+
+static CanalX analizar_mascara(unsigned long mask) {
+    CanalX c;
+    c.mask = (uint32_t)mask;
+    if (!mask) return c;
+    while (!(mask & 1)) { mask >>= 1; c.shift++; }
+    while (mask & 1) { mask >>= 1; c.bits++; }
+    return c;
+}
+
+// Lleva un canal de 'bits' bits a 8 bits (p. ej. 5 -> 8 en visuales 565)
+static inline uint8_t escalar_canal(uint32_t v, int bits) {
+    if (bits == 8) return (uint8_t)v;
+    if (bits > 8) return (uint8_t)(v >> (bits - 8));
+    uint32_t max = (1u << bits) - 1;
+    return (uint8_t)((v * 255 + max / 2) / max);
+}
+
+// Camino genérico: cualquier combinación de 16/24/32 bpp, orden de bytes y máscaras
+static void fila_generica(const uint8_t* src, uint8_t* dst, int n, int bytes_pp, bool msb_first,
+                          const CanalX& r, const CanalX& g, const CanalX& b) {
+    for (int x = 0; x < n; ++x, src += bytes_pp, dst += 4) {
+        uint32_t p = 0;
+        if (msb_first)
+            for (int k = 0; k < bytes_pp; ++k) p = (p << 8) | src[k];
+        else
+            for (int k = bytes_pp - 1; k >= 0; --k) p = (p << 8) | src[k];
+        dst[0] = escalar_canal((p & r.mask) >> r.shift, r.bits);
+        dst[1] = escalar_canal((p & g.mask) >> g.shift, g.bits);
+        dst[2] = escalar_canal((p & b.mask) >> b.shift, b.bits);
+        dst[3] = 255;
+    }
+}
+
+// 32 bpp en memoria B,G,R,X (el caso habitual en visuales TrueColor de 24 bits)
+static void fila_bgrx_escalar(const uint8_t* src, uint8_t* dst, int n) {
+    for (int x = 0; x < n; ++x, src += 4, dst += 4) {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        dst[3] = 255;
+    }
+}
+
+#ifdef CAPTURA_X86
+static void fila_bgrx_sse2(const uint8_t* src, uint8_t* dst, int n) {
+    const __m128i mask_g = _mm_set1_epi32(0x0000ff00);
+    const __m128i mask_b = _mm_set1_epi32(0x000000ff);
+    const __m128i alfa = _mm_set1_epi32((int)0xff000000);
+    int x = 0;
+    for (; x + 4 <= n; x += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i*)(src + 4 * x));
+        __m128i r = _mm_and_si128(_mm_srli_epi32(p, 16), mask_b);
+        __m128i g = _mm_and_si128(p, mask_g);
+        __m128i b = _mm_slli_epi32(_mm_and_si128(p, mask_b), 16);
+        __m128i out = _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, alfa));
+        _mm_storeu_si128((__m128i*)(dst + 4 * x), out);
+    }
+    fila_bgrx_escalar(src + 4 * x, dst + 4 * x, n - x);
+}
+
+__attribute__((target("avx2")))
+static void fila_bgrx_avx2(const uint8_t* src, uint8_t* dst, int n) {
+    const __m256i orden = _mm256_setr_epi8(2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12, -1,
+                                           2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12, -1);
+    const __m256i alfa = _mm256_set1_epi32((int)0xff000000);
+    int x = 0;
+    for (; x + 8 <= n; x += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i*)(src + 4 * x));
+        __m256i out = _mm256_or_si256(_mm256_shuffle_epi8(p, orden), alfa);
+        _mm256_storeu_si256((__m256i*)(dst + 4 * x), out);
+    }
+    fila_bgrx_sse2(src + 4 * x, dst + 4 * x, n - x);
+}
+#endif
+
+typedef void (*KernelFilaBgrx)(const uint8_t*, uint8_t*, int);
+
+static KernelFilaBgrx elegir_kernel_bgrx() {
+#ifdef CAPTURA_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return fila_bgrx_avx2;
+    return fila_bgrx_sse2;
+#else
+    return fila_bgrx_escalar;
+#endif
+}
+
+// Convierte el XImage completo a RGBA (4 bytes por píxel, alfa = 255)
+void convertir_a_rgba(XImage* img, uint8_t* destino, size_t stride_destino) {
+    static const KernelFilaBgrx kernel_bgrx = elegir_kernel_bgrx();
+
+    int width = img->width, height = img->height;
+    int bpp = img->bits_per_pixel;
+    bool msb_first = img->byte_order == MSBFirst;
+    CanalX r = analizar_mascara(img->red_mask);
+    CanalX g = analizar_mascara(img->green_mask);
+    CanalX b = analizar_mascara(img->blue_mask);
+    const uint8_t* origen = (const uint8_t*)img->data;
+
+    bool bgrx = bpp == 32 && !msb_first && r.mask == 0xff0000 && g.mask == 0xff00 && b.mask == 0xff;
+    bool empaquetado = (bpp == 16 || bpp == 24 || bpp == 32) && r.bits && g.bits && b.bits &&
+                       r.bits <= 16 && g.bits <= 16 && b.bits <= 16;
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* src = origen + (size_t)y * img->bytes_per_line;
+        uint8_t* dst = destino + (size_t)y * stride_destino;
+        if (bgrx) {
+            kernel_bgrx(src, dst, width);
+        } else if (empaquetado) {
+            fila_generica(src, dst, width, bpp / 8, msb_first, r, g, b);
+        } else {
+            // Formatos poco comunes (menos de 8 bpp, sin máscaras): último recurso
+            for (int x = 0; x < width; ++x) {
+                unsigned long pixel = XGetPixel(img, x, y);
+                dst[4 * x + 0] = r.bits ? escalar_canal((pixel & r.mask) >> r.shift, r.bits) : 0;
+                dst[4 * x + 1] = g.bits ? escalar_canal((pixel & g.mask) >> g.shift, g.bits) : 0;
+                dst[4 * x + 2] = b.bits ? escalar_canal((pixel & b.mask) >> b.shift, b.bits) : 0;
+                dst[4 * x + 3] = 255;
+            }
+        }
+    }
+}
+
+// Errores X asíncronos (p. ej. XShmAttach en un display remoto)
+static bool error_x = false;
+static int manejador_error_x(Display*, XErrorEvent*) {
+    error_x = true;
+    return 0;
+}
+
+// Segmento MIT-SHM persistente. La memoria compartida se reserva una sola vez
+// por tamaño de región y se reutiliza entre capturas; solo el attach depende
+// de la conexión al servidor X.
+struct CapturaShm {
+    XShmSegmentInfo info = {};
+    XImage* img = nullptr;
+    Display* display = nullptr; // conexión a la que está adjuntado el segmento
+    VisualID visual = 0;
+    int depth = 0;
+    bool no_disponible = false; // el servidor no soporta SHM, se usa XGetImage
+
+    ~CapturaShm() { liberar(); }
+
+    void desconectar() {
+        if (display && img) {
+            XShmDetach(display, &info);
+            XSync(display, False);
+        }
+        display = nullptr;
+    }
+
+    void liberar() {
+        desconectar();
+        if (img) {
+            img->data = nullptr; // la memoria es del segmento, no de Xlib
+            XDestroyImage(img);
+            img = nullptr;
+        }
+        if (info.shmaddr) {
+            shmdt(info.shmaddr);
+            info.shmaddr = nullptr;
+        }
+        info.shmid = -1;
+    }
+
+    // Deja listo el segmento para capturar width x height de la ventana.
+    // Devuelve false si hay que usar el camino XGetImage.
+    bool preparar(Display* dpy, const XWindowAttributes& attr, int width, int height) {
+        if (no_disponible) return false;
+        if (display != dpy) {
+            desconectar();
+            if (!XShmQueryExtension(dpy)) {
+                no_disponible = true;
+                return false;
+            }
+        }
+
+        bool mismo_formato = img && img->width == width && img->height == height &&
+                             visual == XVisualIDFromVisual(attr.visual) && depth == attr.depth;
+        if (!mismo_formato) {
+            desconectar();
+            liberar();
+            img = XShmCreateImage(dpy, attr.visual, attr.depth, ZPixmap, nullptr, &info, width, height);
+            if (!img) {
+                no_disponible = true;
+                return false;
+            }
+            info.shmid = shmget(IPC_PRIVATE, img->bytes_per_line * img->height, IPC_CREAT | 0600);
+            if (info.shmid < 0) {
+                liberar();
+                no_disponible = true;
+                return false;
+            }
+            info.shmaddr = img->data = (char*)shmat(info.shmid, nullptr, 0);
+            info.readOnly = False;
+            if (info.shmaddr == (char*)-1) {
+                info.shmaddr = nullptr;
+                shmctl(info.shmid, IPC_RMID, nullptr);
+                liberar();
+                no_disponible = true;
+                return false;
+            }
+            visual = XVisualIDFromVisual(attr.visual);
+            depth = attr.depth;
+        }
+
+        if (display != dpy) {
+            error_x = false;
+            XErrorHandler anterior = XSetErrorHandler(manejador_error_x);
+            XShmAttach(dpy, &info);
+            XSync(dpy, False);
+            XSetErrorHandler(anterior);
+            if (error_x) {
+                shmctl(info.shmid, IPC_RMID, nullptr);
+                liberar();
+                no_disponible = true;
+                return false;
+            }
+            // Linux mantiene vivo el segmento mientras siga adjuntado
+            shmctl(info.shmid, IPC_RMID, nullptr);
+            display = dpy;
+        }
+        return true;
+    }
+};
+
+static CapturaShm captura_shm;
+
+// Captura la región dada de la ventana con los atributos ya conocidos
+static bool capturar_region(
+    Fotograma& fotograma, CapturaShm& shm,
+    Window win, Display* display, const XWindowAttributes& attributes,
     int offset_x, int offset_y, int region_width, int region_height)
 {
-    XWindowAttributes attributes = {0};
-    XGetWindowAttributes(display, win, &attributes);
-
     // Limita la región a los límites de la ventana
     if (offset_x < 0) offset_x = 0;
     if (offset_y < 0) offset_y = 0;
@@ -58,68 +312,425 @@ void ImageFromWindowRegion(
     if (offset_y + region_height > attributes.height)
         region_height = attributes.height - offset_y;
 
-    Width = region_width;
-    Height = region_height;
+    int Width = region_width;
+    int Height = region_height;
+    if (Width <= 0 || Height <= 0) {
+        cerr << "La región de captura queda fuera de la ventana.\n";
+        return false;
+    }
 
-    XImage* img = XGetImage(display, win, offset_x, offset_y, Width, Height, AllPlanes, ZPixmap);
+    // Camino rápido: XShmGetImage sobre el segmento persistente, sin copia por el socket
+    XImage* img = nullptr;
+    bool usa_shm = shm.preparar(display, attributes, Width, Height) &&
+                   XShmGetImage(display, win, shm.img, offset_x, offset_y, AllPlanes);
+    if (usa_shm) {
+        img = shm.img;
+    } else {
+        img = XGetImage(display, win, offset_x, offset_y, Width, Height, AllPlanes, ZPixmap);
+    }
     if (!img) {
         cerr << "Error al obtener la imagen de la ventana.\n";
-        return;
+        return false;
     }
-    BitsPerPixel = img->bits_per_pixel;
-    Pixels.resize(Width * Height * 4);
-
-    // Convertir a RGBA
-    for (int y = 0; y < Height; ++y) {
-        for (int x = 0; x < Width; ++x) {
-            unsigned long pixel = XGetPixel(img, x, y);
-            uint8_t r = (pixel & img->red_mask) >> 16;
-            uint8_t g = (pixel & img->green_mask) >> 8;
-            uint8_t b = (pixel & img->blue_mask);
-            Pixels[4 * (y * Width + x) + 0] = r;
-            Pixels[4 * (y * Width + x) + 1] = g;
-            Pixels[4 * (y * Width + x) + 2] = b;
-            Pixels[4 * (y * Width + x) + 3] = 255;
+
+    // Convertir a RGBA directamente en el buffer del fotograma
+    fotograma.reservar(Width, Height, FormatoPixel::RGBA);
+    convertir_a_rgba(img, fotograma.datos(), fotograma.stride);
+    fotograma.region_x = offset_x;
+    fotograma.region_y = offset_y;
+    fotograma.ventana_ancho = attributes.width;
+    fotograma.ventana_alto = attributes.height;
+    fotograma.marca_ns = chrono::duration_cast<chrono::nanoseconds>(
+        chrono::system_clock::now().time_since_epoch()).count();
+
+    if (!usa_shm) XDestroyImage(img);
+    return true;
+}
+
+// Suelta el segmento SHM compartido de ImageFromWindowRegion; hay que llamarlo
+// antes de cerrar el Display con el que se usó
+void desconectar_captura_shm() {
+    captura_shm.desconectar();
+}
+
+bool ImageFromWindowRegion(
+    Fotograma& fotograma,
+    Window win, Display* display,
+    int offset_x, int offset_y, int region_width, int region_height)
+{
+    XWindowAttributes attributes = {0};
+    XGetWindowAttributes(display, win, &attributes);
+    return capturar_region(fotograma, captura_shm, win, display, attributes,
+                           offset_x, offset_y, region_width, region_height);
+}
+
+// Nombre de una ventana: _NET_WM_NAME (UTF-8) o, si no lo tiene, WM_NAME
+static string nombre_de_ventana(Display* display, Window win, Atom net_wm_name, Atom utf8_string) {
+    string nombre;
+    Atom tipo;
+    int formato;
+    unsigned long n, restantes;
+    unsigned char* datos = nullptr;
+    if (XGetWindowProperty(display, win, net_wm_name, 0, 1024, False, utf8_string,
+                           &tipo, &formato, &n, &restantes, &datos) == Success && datos) {
+        if (tipo == utf8_string && formato == 8) nombre.assign((char*)datos, n);
+        XFree(datos);
+    }
+    if (nombre.empty()) {
+        XTextProperty prop;
+        if (XGetWMName(display, win, &prop) && prop.value) {
+            nombre = (char*)prop.value;
+            XFree(prop.value);
         }
     }
+    return nombre;
+}
 
-    XDestroyImage(img);
+// Busca la ventana en _NET_CLIENT_LIST (solo ventanas gestionadas, sin recorrer
+// el árbol). 'soportado' queda en false si el gestor de ventanas no lo publica.
+static Window buscar_en_lista_clientes(Display* display, Window root, const string& name, bool& soportado) {
+    Atom net_client_list = XInternAtom(display, "_NET_CLIENT_LIST", False);
+    Atom net_wm_name = XInternAtom(display, "_NET_WM_NAME", False);
+    Atom utf8_string = XInternAtom(display, "UTF8_STRING", False);
+
+    Atom tipo;
+    int formato;
+    unsigned long n = 0, restantes;
+    unsigned char* datos = nullptr;
+    soportado = XGetWindowProperty(display, root, net_client_list, 0, 1 << 16, False, XA_WINDOW,
+                                   &tipo, &formato, &n, &restantes, &datos) == Success &&
+                tipo == XA_WINDOW && datos;
+    if (!soportado) {
+        if (datos) XFree(datos);
+        return 0;
+    }
+
+    Window result = 0;
+    Window* clientes = (Window*)datos;
+    for (unsigned long i = 0; i < n && !result; ++i) {
+        if (nombre_de_ventana(display, clientes[i], net_wm_name, utf8_string).find(name) != string::npos)
+            result = clientes[i];
+    }
+    XFree(datos);
+    return result;
 }
 
-int tomar_captura()
-{
+// ---- SesionCaptura ----
+
+struct SesionCaptura::EstadoX {
+    Display* display = nullptr;
+    Window ventana = 0;
+    XWindowAttributes attr = {};
+    CapturaShm shm;
+
+    // Fotograma sobre el que se parchean los daños en modo incremental
+    const Fotograma* base = nullptr;
+#ifdef USE_XDAMAGE
+    bool damage_disponible = false;
+    int damage_evento = 0;
+    Damage damage = 0;
+    XserverRegion region_danada = 0;
+#endif
+};
+
+SesionCaptura::SesionCaptura(const string& nombre_ventana)
+    : nombre_ventana(nombre_ventana), x(new EstadoX) {}
 
-    int Width, Height, BitsPerPixel;
-    vector<uint8_t> Pixels;
+SesionCaptura::~SesionCaptura() {
+    if (x->display) {
+        invalidar_ventana();
+#ifdef USE_XDAMAGE
+        if (x->region_danada) XFixesDestroyRegion(x->display, x->region_danada);
+#endif
+        x->shm.desconectar();
+        XCloseDisplay(x->display);
+    }
+}
+
+void SesionCaptura::fijar_region(int rx, int ry, int ancho, int alto) {
+    region_x = rx;
+    region_y = ry;
+    region_ancho = ancho;
+    region_alto = alto;
+}
 
-    Display* display = XOpenDisplay(nullptr);
-    if (!display) {
+void SesionCaptura::usar_localizador(const Fotograma& referencia) {
+    borde = referencia;
+    region_localizada = false;
+    siguiente_busqueda = {};
+}
+
+bool SesionCaptura::conectar() {
+    if (x->display) return true;
+    x->display = XOpenDisplay(nullptr);
+    if (!x->display) {
         cerr << "No se pudo abrir el display X11.\n";
-        return 1;
+        return false;
+    }
+#ifdef USE_XDAMAGE
+    int error_base, evento_fixes;
+    x->damage_disponible = XDamageQueryExtension(x->display, &x->damage_evento, &error_base) &&
+                           XFixesQueryExtension(x->display, &evento_fixes, &error_base);
+    if (x->damage_disponible) x->region_danada = XFixesCreateRegion(x->display, nullptr, 0);
+#endif
+    return true;
+}
+
+bool SesionCaptura::preparar() {
+    if (!conectar()) return false;
+    procesar_eventos();
+    if (!x->ventana && !resolver_ventana()) return false;
+    if (borde.ancho > 0 && !region_localizada && chrono::steady_clock::now() >= siguiente_busqueda)
+        localizar_region();
+    return x->ventana != 0;
+}
+
+// Captura la ventana completa y busca en ella el canvas. Si no aparece (p. ej.
+// el juego aún no está en pantalla) se mantiene la región anterior y se
+// vuelve a intentar pasado un segundo, o antes si la ventana cambia: a 60 fps
+// buscar en cada captura dejaría al hilo de captura sin hacer otra cosa.
+void SesionCaptura::localizar_region() {
+    static const chrono::milliseconds ESPERA_REINTENTO(1000);
+    error_x = false;
+    XErrorHandler anterior = XSetErrorHandler(manejador_error_x);
+    XImage* img = XGetImage(x->display, x->ventana, 0, 0, x->attr.width, x->attr.height, AllPlanes, ZPixmap);
+    XSync(x->display, False);
+    XSetErrorHandler(anterior);
+    if (!img || error_x) {
+        if (img) XDestroyImage(img);
+        invalidar_ventana();
+        return;
+    }
+    Fotograma ventana_completa;
+    ventana_completa.reservar(img->width, img->height, FormatoPixel::RGBA);
+    convertir_a_rgba(img, ventana_completa.datos(), ventana_completa.stride);
+    XDestroyImage(img);
+
+    int cx, cy;
+    if (!localizar_canvas(ventana_completa, borde, cx, cy)) {
+        siguiente_busqueda = chrono::steady_clock::now() + ESPERA_REINTENTO;
+        if (!aviso_localizador) {
+            cerr << "No se encontró el canvas del juego en la ventana; se usa la región ("
+                 << region_x << ", " << region_y << ")\n";
+            aviso_localizador = true;
+        }
+        return;
+    }
+    if (cx != region_x || cy != region_y) {
+        cout << "Canvas localizado en (" << cx << ", " << cy << ")\n";
+        x->base = nullptr; // la captura incremental parte de cero con la nueva región
     }
+    region_x = cx;
+    region_y = cy;
+    region_localizada = true;
+    aviso_localizador = false;
+}
+
+void SesionCaptura::invalidar_ventana() {
+#ifdef USE_XDAMAGE
+    if (x->damage) {
+        // Si la ventana ya no existe el servidor liberó el Damage: se ignora BadDamage
+        error_x = false;
+        XErrorHandler anterior = XSetErrorHandler(manejador_error_x);
+        XDamageDestroy(x->display, x->damage);
+        XSync(x->display, False);
+        XSetErrorHandler(anterior);
+        x->damage = 0;
+    }
+#endif
+    x->ventana = 0;
+    x->base = nullptr;
+}
 
+bool SesionCaptura::resolver_ventana() {
+    Display* display = x->display;
     Window root = DefaultRootWindow(display);
-    Window firefoxWin = FindWindowByName(display, root, "Firefox");
-    if (!firefoxWin) {
-        cerr << "No se encontró una ventana de Firefox.\n";
-        XCloseDisplay(display);
-        return 1;
+    bool soportado = false;
+    Window win = buscar_en_lista_clientes(display, root, nombre_ventana, soportado);
+    // Sin gestor de ventanas EWMH (p. ej. Xvfb pelado) se recorre el árbol
+    if (!soportado) win = FindWindowByName(display, root, nombre_ventana);
+    if (!win) {
+        cerr << "No se encontró una ventana de " << nombre_ventana << ".\n";
+        return false;
     }
 
-    cout << "Ventana de Firefox encontrada: " << firefoxWin << "\n";    
-    int canvas_offset_x = 666;
-    int canvas_offset_y = 275;
-    int canvas_width = 427;
-    int canvas_height = 640;
+    error_x = false;
+    XErrorHandler anterior = XSetErrorHandler(manejador_error_x);
+    XSelectInput(display, win, StructureNotifyMask);
+    Status ok = XGetWindowAttributes(display, win, &x->attr);
+    XSync(display, False);
+    XSetErrorHandler(anterior);
+    if (!ok || error_x) return false;
 
-    ImageFromWindowRegion(Pixels, Width, Height, BitsPerPixel, firefoxWin, display, canvas_offset_x, canvas_offset_y, canvas_width, canvas_height);
+    x->ventana = win;
+    region_localizada = false; // ventana nueva o de otro tamaño: el canvas pudo moverse
+    siguiente_busqueda = {};
+#ifdef USE_XDAMAGE
+    if (x->damage_disponible) x->damage = XDamageCreate(display, win, XDamageReportNonEmpty);
+#endif
+    cout << "Ventana de " << nombre_ventana << " encontrada: " << win << "\n";
+    return true;
+}
+
+// Vacía la cola de eventos: solo interesa si la ventana desaparece o cambia de tamaño
+void SesionCaptura::procesar_eventos() {
+    Display* display = x->display;
+    while (XPending(display)) {
+        XEvent ev;
+        XNextEvent(display, &ev);
+        if (ev.type == DestroyNotify && ev.xdestroywindow.window == x->ventana) {
+            invalidar_ventana();
+        } else if (ev.type == ConfigureNotify && ev.xconfigure.window == x->ventana) {
+            if (ev.xconfigure.width != x->attr.width || ev.xconfigure.height != x->attr.height)
+                invalidar_ventana();
+        }
+        // Los XDamageNotify solo se descartan: el área se consulta con XDamageSubtract
+    }
+}
+
+bool SesionCaptura::capturar(Fotograma& fotograma) {
+    if (!preparar()) return false;
+    x->base = nullptr;
+    return capturar_completo(fotograma);
+}
+
+bool SesionCaptura::capturar_completo(Fotograma& fotograma) {
+    // Si la ventana desaparece entre eventos, XGetImage da BadWindow/BadMatch
+    error_x = false;
+    XErrorHandler anterior = XSetErrorHandler(manejador_error_x);
+    bool ok = capturar_region(fotograma, x->shm, x->ventana, x->display, x->attr,
+                              region_x, region_y, region_ancho, region_alto);
+    XSync(x->display, False);
+    XSetErrorHandler(anterior);
+    if (error_x) {
+        invalidar_ventana();
+        return false;
+    }
+    return ok;
+}
+
+bool SesionCaptura::capturar_incremental(Fotograma& fotograma, vector<bool>& celdas_cambiadas,
+                                         int filas, int columnas) {
+    if (!preparar()) return false;
+
+    bool base_valida = x->base == &fotograma && fotograma.ancho > 0;
+#ifdef USE_XDAMAGE
+    if (base_valida && x->damage)
+        return aplicar_danos(fotograma, celdas_cambiadas, filas, columnas);
+    // Se descarta el daño acumulado antes de la captura completa para no perder
+    // cambios que lleguen mientras tanto
+    if (x->damage) XDamageSubtract(x->display, x->damage, None, None);
+#endif
+    (void)base_valida;
+    celdas_cambiadas.assign(filas * columnas, true);
+    if (!capturar_completo(fotograma)) return false;
+    x->base = &fotograma;
+    return true;
+}
+
+#ifdef USE_XDAMAGE
+// Marca las celdas de la rejilla que tocan el rectángulo [x0,x1) x [y0,y1) del canvas
+static void marcar_celdas(vector<bool>& celdas, int filas, int columnas, int block_w, int block_h,
+                          int x0, int y0, int x1, int y1) {
+    int j0 = min(x0 / block_w, columnas - 1), j1 = min((x1 - 1) / block_w, columnas - 1);
+    int i0 = min(y0 / block_h, filas - 1), i1 = min((y1 - 1) / block_h, filas - 1);
+    for (int i = i0; i <= i1; ++i)
+        for (int j = j0; j <= j1; ++j)
+            celdas[i * columnas + j] = true;
+}
+#endif
+
+bool SesionCaptura::aplicar_danos(Fotograma& fotograma, vector<bool>& celdas_cambiadas,
+                                  int filas, int columnas) {
+    celdas_cambiadas.assign(filas * columnas, false);
+#ifdef USE_XDAMAGE
+    Display* display = x->display;
+    XDamageSubtract(display, x->damage, None, x->region_danada);
+    int n = 0;
+    XRectangle* rects = XFixesFetchRegion(display, x->region_danada, &n);
+
+    // Misma rejilla que clasificar_celdas
+    int block_h = (int)round((float)fotograma.alto / filas);
+    int block_w = (int)round((float)fotograma.ancho / columnas);
+    int cx = max(region_x, 0), cy = max(region_y, 0);
+
+    error_x = false;
+    XErrorHandler anterior = XSetErrorHandler(manejador_error_x);
+    for (int r = 0; r < n && !error_x; ++r) {
+        // Intersección con el canvas, en coordenadas del canvas
+        int x0 = max((int)rects[r].x - cx, 0);
+        int y0 = max((int)rects[r].y - cy, 0);
+        int x1 = min((int)rects[r].x + (int)rects[r].width - cx, fotograma.ancho);
+        int y1 = min((int)rects[r].y + (int)rects[r].height - cy, fotograma.alto);
+        if (x0 >= x1 || y0 >= y1) continue;
 
-    if (stbi_write_png("captura_firefox.png", Width, Height, 4, Pixels.data(), Width * 4)) {
+        XImage* img = XGetImage(display, x->ventana, cx + x0, cy + y0, x1 - x0, y1 - y0, AllPlanes, ZPixmap);
+        if (!img) continue;
+        convertir_a_rgba(img, fotograma.datos() + (size_t)y0 * fotograma.stride + x0 * 4, fotograma.stride);
+        XDestroyImage(img);
+        marcar_celdas(celdas_cambiadas, filas, columnas, block_w, block_h, x0, y0, x1, y1);
+    }
+    XSync(display, False);
+    XSetErrorHandler(anterior);
+    if (rects) XFree(rects);
+    if (error_x) {
+        invalidar_ventana();
+        return false;
+    }
+#else
+    (void)fotograma;
+#endif
+    return true;
+}
+
+bool cargar_borde_referencia(const char* archivo, Fotograma& borde) {
+    int w, h, c;
+    unsigned char* img = stbi_load(archivo, &w, &h, &c, 3);
+    if (!img) return false;
+    int alto_borde = min(h, 2 * 43);
+    borde.reservar(w, alto_borde, FormatoPixel::RGB);
+    memcpy(borde.datos(), img, (size_t)w * alto_borde * 3);
+    stbi_image_free(img);
+    return true;
+}
+
+bool cargar_borde_juego(Fotograma& borde) {
+#ifdef PLANTILLAS_EMBEBIDAS
+    if (borde_embebido.w > 0) {
+        borde.reservar(borde_embebido.w, borde_embebido.h, FormatoPixel::RGB);
+        for (int y = 0; y < borde.alto; ++y)
+            memcpy(borde.datos() + (size_t)y * borde.stride, borde_embebido.pixeles + (size_t)y * borde.ancho * 3,
+                   (size_t)borde.ancho * 3);
+        return true;
+    }
+#endif
+    if (cargar_borde_referencia("niveles/nivel2.png", borde)) return true;
+    cerr << "Sin niveles/nivel2.png: se usa la región fija del canvas\n";
+    return false;
+}
+
+int tomar_captura(Fotograma& fotograma, bool guardar_png)
+{
+    // La sesión vive todo el programa: display abierto y ventana cacheada
+    static SesionCaptura sesion("Firefox");
+    static bool sesion_iniciada = false;
+    if (!sesion_iniciada) {
+        Fotograma borde;
+        if (cargar_borde_juego(borde)) sesion.usar_localizador(borde);
+        sesion_iniciada = true;
+    }
+    if (!sesion.capturar(fotograma)) return 1;
+
+    // Volcado opcional para depuración; el clasificador usa el fotograma en memoria
+    if (guardar_png) guardar_captura_png(fotograma);
+    return 0;
+}
+
+void guardar_captura_png(const Fotograma& fotograma) {
+    if (stbi_write_png("captura_firefox.png", fotograma.ancho, fotograma.alto, fotograma.canales(),
+                       fotograma.datos(), fotograma.stride)) {
         cout << "Captura de ventana de Firefox guardada como 'captura_firefox.png'\n";
     } else {
         cerr << "Error al guardar la captura\n";
     }
-
-    XCloseDisplay(display);
-    return 0;
-}
\ No newline at end of file
+}